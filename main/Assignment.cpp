@@ -0,0 +1,69 @@
+///////////////////////////
+// File: Assignment.cpp  //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#include "Assignment.h"
+#include <cstddef>
+#include <limits>
+
+std::vector<int> Assignment::solve(int n, const std::vector<double>& cost) {
+    // Returns the job of each worker. Workers are added one at a time; each
+    // addition grows a tree of tight edges from the new worker until it reaches
+    // a free job, adjusting the potentials u and v so every edge stays
+    // non-negative, then flips the augmenting path. Index 0 is a sentinel.
+    const double infinity = std::numeric_limits<double>::infinity();
+    std::vector<double> u(n + 1, 0), v(n + 1, 0);
+    std::vector<int> jobOwner(n + 1, 0), previousJob(n + 1, 0);
+
+    for (int worker = 1; worker <= n; ++worker) {
+        jobOwner[0] = worker;
+        int job = 0;
+        std::vector<double> slack(n + 1, infinity);
+        std::vector<char> visited(n + 1, 0);
+        do {
+            visited[job] = 1;
+            int owner = jobOwner[job];
+            const double* ownerCost = &cost[static_cast<size_t>(owner - 1) * n];
+            double delta = infinity;
+            int nextJob = 0;
+            for (int j = 1; j <= n; ++j) {
+                if (visited[j]) continue;
+                double reduced = ownerCost[j - 1] - u[owner] - v[j];
+                if (reduced < slack[j]) {
+                    slack[j] = reduced;
+                    previousJob[j] = job;
+                }
+                if (slack[j] < delta) {
+                    delta = slack[j];
+                    nextJob = j;
+                }
+            }
+            for (int j = 0; j <= n; ++j) {
+                if (visited[j]) {
+                    u[jobOwner[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    slack[j] -= delta;
+                }
+            }
+            job = nextJob;
+        } while (jobOwner[job] != 0);
+
+        // Flip the alternating path back to the sentinel
+        do {
+            int previous = previousJob[job];
+            jobOwner[job] = jobOwner[previous];
+            job = previous;
+        } while (job != 0);
+    }
+
+    std::vector<int> jobOf(n, -1);
+    for (int j = 1; j <= n; ++j) {
+        jobOf[jobOwner[j] - 1] = j - 1;
+    }
+    return jobOf;
+}
@@ -0,0 +1,21 @@
+///////////////////////////
+// File: Assignment.h    //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#ifndef ASSIGNMENT_H
+#define ASSIGNMENT_H
+
+#include <vector>
+
+// Minimum-cost perfect matching of n workers to n jobs (Hungarian algorithm
+// with potentials, O(n^3)). cost holds the n x n matrix row by row.
+class Assignment {
+public:
+    static std::vector<int> solve(int n, const std::vector<double>& cost);
+};
+
+#endif // ASSIGNMENT_H
@@ -0,0 +1,66 @@
+///////////////////////////
+// File: CellStore.cpp   //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#include "CellStore.h"
+#include <algorithm>
+
+int CellStore::addCell(const std::string& name, double width, double height) {
+    int id = size();
+    nameOffsets.push_back(nameChars.size());
+    nameChars.insert(nameChars.end(), name.begin(), name.end());
+    nameChars.push_back('\0');
+    // On duplicate names the first cell keeps the name
+    nameIndex.emplace(name, id);
+
+    x.push_back(0);
+    y.push_back(0);
+    this->width.push_back(width);
+    this->height.push_back(height);
+    density.push_back(0);
+    isFixed.push_back(false);
+    originalX.push_back(0);
+    originalY.push_back(0);
+    orientationIds.push_back(0);
+    if (orientations.empty()) {
+        orientations.push_back("N");
+    }
+    return id;
+}
+
+int CellStore::size() const {
+    return static_cast<int>(x.size());
+}
+
+const char* CellStore::name(int id) const {
+    return nameChars.data() + nameOffsets[id];
+}
+
+int CellStore::find(const std::string& name) const {
+    // Returns the id of the named cell, or -1 if there is none
+    auto it = nameIndex.find(name);
+    return it == nameIndex.end() ? -1 : it->second;
+}
+
+const std::string& CellStore::orientation(int id) const {
+    return orientations[orientationIds[id]];
+}
+
+void CellStore::setOrientation(int id, const std::string& orientation) {
+    auto it = std::find(orientations.begin(), orientations.end(), orientation);
+    if (it == orientations.end()) {
+        orientations.push_back(orientation);
+        it = orientations.end() - 1;
+    }
+    orientationIds[id] = static_cast<int>(it - orientations.begin());
+}
+
+void CellStore::resetPositions() {
+    // Moves every cell back to its global placement position
+    x = originalX;
+    y = originalY;
+}
@@ -0,0 +1,58 @@
+///////////////////////////
+// File: CellStore.h     //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#ifndef CELLSTORE_H
+#define CELLSTORE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Structure-of-arrays storage for all cells. A cell is identified by its
+// integer id, the index into every attribute array. Names live in a separate
+// string table so the hot coordinate arrays stay dense.
+class CellStore {
+public:
+    int addCell(const std::string& name, double width, double height);
+    int size() const;
+
+    const char* name(int id) const;
+    int find(const std::string& name) const;
+    const std::string& orientation(int id) const;
+    void setOrientation(int id, const std::string& orientation);
+    void resetPositions();
+
+    std::vector<double> x; // Left-bottom x-coordinate
+    std::vector<double> y; // Left-bottom y-coordinate
+    std::vector<double> width;
+    std::vector<double> height;
+    std::vector<int> density;
+    std::vector<char> isFixed; // Bitwise or of the Fixed* flags; zero for movable cells
+
+    static const char FixedTerminal = 1;    // "terminal" in .nodes
+    static const char FixedPlacement = 2;   // "/FIXED" in .pl, written back to the output
+
+    // Original global placement coordinates
+    std::vector<double> originalX;
+    std::vector<double> originalY;
+
+private:
+    friend class Snapshot;
+
+    // Null-terminated names packed back to back, and where each one starts
+    std::vector<char> nameChars;
+    std::vector<size_t> nameOffsets;
+    // Name -> id, for resolving cells referenced by .pl, .nets and .wts
+    std::unordered_map<std::string, int> nameIndex;
+
+    // Orientations are interned; designs only use a handful of distinct values
+    std::vector<int> orientationIds;
+    std::vector<std::string> orientations;
+};
+
+#endif // CELLSTORE_H
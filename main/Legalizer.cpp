@@ -7,42 +7,154 @@
 ///////////////////////////
 
 #include "Legalizer.h"
-#include "Cell.h"
+#include "Assignment.h"
+#include "CellStore.h"
+#include "NetBoxCache.h"
 #include "Row.h"
-#include "Site.h"
+#include "Utilities.h"
 #include <algorithm>
 #include <cmath>
 #include <random>
 #include <chrono>
 #include <iostream>
+#include <limits>
+#include <functional>
+#include <map>
+#include <numeric>
+
+Legalizer::Legalizer(CellStore& cells, std::vector<std::shared_ptr<Row>>& rows, double siteWidth)
+    : cells(cells), rows(rows), siteWidth(siteWidth), threadCount(1), passCount(0), displacementLimit(0),
+      adaptiveCooling(true), stallMoves(100000), minRelativeGain(1e-4), wirelengthWeight(0),
+      totalDisplacement(0), maxDisplacement(0) {
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        if (!cells.isFixed[cell]) allCells.push_back(cell);
+    }
+    buildRowIndex();
+    blockFixedCells();
+
+    // Cells taller than a row cover that many stacked rows, counted against the bottom row height
+    rowSpan.assign(cells.size(), 1);
+    double rowHeight = rowsByY.empty() ? 0 : rows[rowsByY[0]]->height;
+    if (rowHeight > 0) {
+        for (int cell = 0; cell < cells.size(); ++cell) {
+            rowSpan[cell] = std::max(1, static_cast<int>(std::ceil(cells.height[cell] / rowHeight - 1e-6)));
+        }
+    }
+}
+
+Legalizer::~Legalizer() = default;
+
+void Legalizer::setThreadCount(int threads) {
+    threadCount = std::max(1, threads);
+}
+
+void Legalizer::setMaxDisplacement(double limit) {
+    // With a positive limit greedy placement searches windows no larger than the
+    // limit first, and annealing rejects moves that take a cell beyond it
+    displacementLimit = std::max(0.0, limit);
+}
+
+void Legalizer::setAnnealingSchedule(bool adaptive, long long stallMoveCount, double minGain) {
+    // adaptive selects the modified Lam schedule over geometric cooling. An
+    // annealing run stops after stallMoveCount moves without a new best, and
+    // simulatedAnnealing stops after a pass gaining less than minGain of the
+    // cost; zero disables either check.
+    adaptiveCooling = adaptive;
+    stallMoves = std::max(0LL, stallMoveCount);
+    minRelativeGain = std::max(0.0, minGain);
+}
+
+void Legalizer::setWirelengthWeight(const NetStore& nets, double weight) {
+    // With a positive weight simulated annealing minimizes displacement plus
+    // weight times the weighted half-perimeter wirelength of the nets
+    wirelengthWeight = std::max(0.0, weight);
+    wirelengthCache.reset(wirelengthWeight > 0 ? new NetBoxCache(nets, cells) : nullptr);
+}
+
+void Legalizer::computeDensity(double epsilon, bool bruteForce) {
+    double radius = epsilon * siteWidth;
+    if (bruteForce || radius <= 0) {
+        computeDensityBruteForce(radius);
+    } else {
+        computeDensityGrid(radius);
+    }
+#ifdef DEBUG_LEGALIZER
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        std::cout << cells.name(cell) << " " << cells.density[cell] << std::endl;
+    }
+#endif
+}
 
-Legalizer::Legalizer(std::vector<std::shared_ptr<Cell>>& cells, std::vector<std::shared_ptr<Row>>& rows, double siteWidth)
-    : cells(cells), rows(rows), siteWidth(siteWidth), totalDisplacement(0), maxDisplacement(0) {}
-
-void Legalizer::computeDensity(double epsilon) {
-    // Simple density calculation without hash tables
-    for (auto& cell : cells) {
-        cell->density = 0;
-        for (auto& otherCell : cells) {
-            if (cell == otherCell) continue;
-            double dx = cell->x - otherCell->x;
-            double dy = cell->y - otherCell->y;
+void Legalizer::computeDensityBruteForce(double radius) {
+    // Reference O(n^2) density calculation, kept for cross-checking the grid
+    // Fixed cells neither get a density nor count towards one
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        cells.density[cell] = 0;
+        if (cells.isFixed[cell]) continue;
+        for (int otherCell = 0; otherCell < cells.size(); ++otherCell) {
+            if (cell == otherCell || cells.isFixed[otherCell]) continue;
+            double dx = cells.x[cell] - cells.x[otherCell];
+            double dy = cells.y[cell] - cells.y[otherCell];
             double distance = std::sqrt(dx * dx + dy * dy);
-            if (distance <= epsilon * siteWidth) {
-                cell->density++;
+            if (distance <= radius) {
+                cells.density[cell]++;
             }
         }
     }
-#ifdef DEBUG_LEGALIZER
-    for (const auto& cell : cells) {
-        std::cout << cell->name << " " << cell->density << std::endl;
+}
+
+void Legalizer::computeDensityGrid(double radius) {
+    // Bucket cells into square bins slightly larger than the radius so that every
+    // neighbor within the radius lies in one of the 3x3 surrounding bins, even
+    // when floor() rounds a coordinate across a bin edge.
+    double binSize = radius * (1.0 + 1e-9);
+    struct BinEntry {
+        long long bx;
+        long long by;
+        int index;
+        bool operator<(const BinEntry& other) const {
+            if (bx != other.bx) return bx < other.bx;
+            if (by != other.by) return by < other.by;
+            return index < other.index;
+        }
+    };
+
+    std::vector<BinEntry> entries;
+    entries.reserve(cells.size());
+    for (int i = 0; i < cells.size(); ++i) {
+        cells.density[i] = 0;
+        if (cells.isFixed[i]) continue;
+        entries.push_back({static_cast<long long>(std::floor(cells.x[i] / binSize)),
+                           static_cast<long long>(std::floor(cells.y[i] / binSize)),
+                           static_cast<int>(i)});
+    }
+    // Sorted by (bx, by): the bins (bx, by-1..by+1) form one contiguous range
+    std::sort(entries.begin(), entries.end());
+
+    for (const auto& entry : entries) {
+        int cell = entry.index;
+        for (long long bx = entry.bx - 1; bx <= entry.bx + 1; ++bx) {
+            BinEntry lowKey = {bx, entry.by - 1, std::numeric_limits<int>::min()};
+            BinEntry highKey = {bx, entry.by + 1, std::numeric_limits<int>::max()};
+            auto first = std::lower_bound(entries.begin(), entries.end(), lowKey);
+            auto last = std::upper_bound(first, entries.end(), highKey);
+            for (auto it = first; it != last; ++it) {
+                if (it->index == entry.index) continue;
+                int otherCell = it->index;
+                double dx = cells.x[cell] - cells.x[otherCell];
+                double dy = cells.y[cell] - cells.y[otherCell];
+                double distance = std::sqrt(dx * dx + dy * dy);
+                if (distance <= radius) {
+                    cells.density[cell]++;
+                }
+            }
+        }
     }
-#endif
 }
 
 void Legalizer::sortAndCluster() {
     // Separate cells that are outside the chip boundary
-    std::vector<std::shared_ptr<Cell>> outOfBoundsCells;
+    std::vector<int> outOfBoundsCells;
 
     double minX = std::numeric_limits<double>::max();
     double minY = std::numeric_limits<double>::max();
@@ -63,14 +175,14 @@ void Legalizer::sortAndCluster() {
     std::cout << "Chip boundary: " << minX << " " << minY << " " << maxX << " " << maxY << std::endl;
 #endif
 
-    for (auto& cell : cells) {
+    for (int cell : allCells) {
         bool outOfBounds = false;
-        if (cell->originalX < minX || cell->originalX + cell->width > maxX ||
-            cell->originalY < minY || cell->originalY + cell->height > maxY) {
+        if (cells.originalX[cell] < minX || cells.originalX[cell] + cells.width[cell] > maxX ||
+            cells.originalY[cell] < minY || cells.originalY[cell] + cells.height[cell] > maxY) {
             outOfBounds = true;
 #ifdef DEBUG_LEGALIZER
-            std::cout << "Cell " << cell->name << " is out of bounds" << std::endl;
-            // std::cout << "Cell: " << cell->originalX << " " << cell->originalY << " " << cell->width << " " << cell->height << std::endl;
+            std::cout << "Cell " << cells.name(cell) << " is out of bounds" << std::endl;
+            // std::cout << "Cell: " << cells.originalX[cell] << " " << cells.originalY[cell] << " " << cells.width[cell] << " " << cells.height[cell] << std::endl;
 #endif
         }
         if (outOfBounds) {
@@ -84,22 +196,23 @@ void Legalizer::sortAndCluster() {
     }
 
     // Sort remaining cells by density descending
-    std::sort(cells.begin(), cells.end(), [](const std::shared_ptr<Cell>& a, const std::shared_ptr<Cell>& b) {
-        return a->density > b->density;
+    std::vector<int> sortedCells = allCells;
+    std::sort(sortedCells.begin(), sortedCells.end(), [this](int a, int b) {
+        return cells.density[a] > cells.density[b];
     });
 
     // Cluster remaining cells with similar density and positions
     const int densityThreshold = 3; // Define a suitable threshold
-    for (auto& cell : cells) {
+    for (int cell : sortedCells) {
         if (std::find(outOfBoundsCells.begin(), outOfBoundsCells.end(), cell) != outOfBoundsCells.end()) continue;
 
         bool added = false;
         for (auto& cluster : clusters) {
             if (!cluster.empty()) {
-                double dx = cell->x - cluster.front()->x;
-                double dy = cell->y - cluster.front()->y;
+                double dx = cells.x[cell] - cells.x[cluster.front()];
+                double dy = cells.y[cell] - cells.y[cluster.front()];
                 double distance = std::sqrt(dx * dx + dy * dy);
-                if (std::abs(cell->density - cluster.front()->density) <= densityThreshold && distance <= 2 * siteWidth) {
+                if (std::abs(cells.density[cell] - cells.density[cluster.front()]) <= densityThreshold && distance <= 2 * siteWidth) {
                     cluster.push_back(cell);
                     added = true;
                     break;
@@ -113,14 +226,14 @@ void Legalizer::sortAndCluster() {
 
     // Within each cluster, sort cells by width ascending
     for (auto& cluster : clusters) {
-        std::sort(cluster.begin(), cluster.end(), [](const std::shared_ptr<Cell>& a, const std::shared_ptr<Cell>& b) {
-            return a->width < b->width;
+        std::sort(cluster.begin(), cluster.end(), [this](int a, int b) {
+            return cells.width[a] < cells.width[b];
         });
     }
 
     // print first cluster
     // for (auto& cell : clusters[0]) {
-    //     std::cout << cell->name << " " << cell->density << std::endl;
+    //     std::cout << cells.name(cell) << " " << cells.density[cell] << std::endl;
     // }
 
 #ifdef DEBUG_LEGALIZER
@@ -128,85 +241,766 @@ void Legalizer::sortAndCluster() {
 #endif
 }
 
+void Legalizer::buildRowIndex() {
+    rowsByY.resize(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rowsByY[i] = static_cast<int>(i);
+    }
+    std::stable_sort(rowsByY.begin(), rowsByY.end(), [this](int a, int b) {
+        return rows[a]->originY < rows[b]->originY;
+    });
+    rowRank.resize(rows.size());
+    for (size_t i = 0; i < rowsByY.size(); ++i) {
+        rowRank[rowsByY[i]] = static_cast<int>(i);
+    }
+
+    // A multi-row cell needs rows that abut vertically and share one site grid,
+    // so that site i of each of them lies at the same x
+    spanLimit.assign(rows.size(), 1);
+    for (int rank = static_cast<int>(rowsByY.size()) - 2; rank >= 0; --rank) {
+        const auto& lower = rows[rowsByY[rank]];
+        const auto& upper = rows[rowsByY[rank + 1]];
+        if (std::abs(upper->originY - (lower->originY + lower->height)) <= 1e-6 * lower->height &&
+            upper->originX == lower->originX && upper->siteWidth == lower->siteWidth) {
+            spanLimit[rowsByY[rank]] = spanLimit[rowsByY[rank + 1]] + 1;
+        }
+    }
+}
+
+void Legalizer::blockFixedCells() {
+    // Sites under fixed cells are occupied up front, so every placement engine
+    // only ever sees the free segments between them. Fixed cells outside the
+    // rows, such as I/O pads, block nothing.
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        if (!cells.isFixed[cell]) continue;
+        double left = cells.x[cell];
+        double right = cells.x[cell] + cells.width[cell];
+        double bottom = cells.y[cell];
+        double top = cells.y[cell] + cells.height[cell];
+        for (auto& row : rows) {
+            if (row->originY >= top || row->originY + row->height <= bottom) continue;
+            int start = static_cast<int>(std::max(std::floor((left - row->originX) / row->siteWidth), 0.0));
+            int end = static_cast<int>(std::min(std::ceil((right - row->originX) / row->siteWidth),
+                                                static_cast<double>(row->siteCount)));
+            if (start < end) row->occupy(start, end - start, cell);
+        }
+    }
+}
+
+int Legalizer::rowIndexAt(double y) const {
+    auto it = std::lower_bound(rowsByY.begin(), rowsByY.end(), y,
+        [this](int r, double value) { return rows[r]->originY < value; });
+    if (it == rowsByY.end() || rows[*it]->originY != y) return -1;
+    return *it;
+}
+
+bool Legalizer::locateCell(int cell, int& rowIndex, int& siteIndex) const {
+    // Finds the row and first site a placed cell occupies; false if it is not on the site grid
+    rowIndex = rowIndexAt(cells.y[cell]);
+    if (rowIndex < 0) return false;
+    const auto& row = rows[rowIndex];
+    siteIndex = static_cast<int>(std::floor((cells.x[cell] - row->originX) / row->siteWidth + 0.5));
+    if (siteIndex < 0 || siteIndex >= row->siteCount) return false;
+    return row->siteCells[siteIndex] == cell;
+}
+
+int Legalizer::rowAbove(int rowIndex, int level) const {
+    return rowsByY[rowRank[rowIndex] + level];
+}
+
+void Legalizer::forEachRowOutward(double y, const std::function<bool(int, double)>& visit) {
+    // Visit rows in order of increasing vertical distance from y, starting at the
+    // nearest one; stops early when visit returns false.
+    int up = static_cast<int>(std::lower_bound(rowsByY.begin(), rowsByY.end(), y,
+        [this](int r, double value) { return rows[r]->originY < value; }) - rowsByY.begin());
+    int down = up - 1;
+    int rowCount = static_cast<int>(rowsByY.size());
+    while (up < rowCount || down >= 0) {
+        int rowIndex;
+        if (down < 0 || (up < rowCount && rows[rowsByY[up]]->originY - y <= y - rows[rowsByY[down]]->originY)) {
+            rowIndex = rowsByY[up++];
+        } else {
+            rowIndex = rowsByY[down--];
+        }
+        if (!visit(rowIndex, std::abs(rows[rowIndex]->originY - y))) break;
+    }
+}
+
+bool Legalizer::findNearestFreeSite(int cell, int& bestRow, int& bestSite, double radius) {
+    if (rowSpan[cell] > 1) return findNearestFreeSpan(cell, bestRow, bestSite, radius);
+    int sitesNeeded = static_cast<int>(std::ceil(cells.width[cell] / siteWidth));
+    double minDistance = radius;
+    bestRow = -1;
+    bestSite = -1;
+
+    // Rows are visited outward from the original y until the vertical distance
+    // alone exceeds the radius or the best candidate found
+    forEachRowOutward(cells.originalY[cell], [&](int rowIndex, double dy) {
+        if (dy > minDistance) return false;
+        auto& row = rows[rowIndex];
+
+        // Small slack keeps equal-distance candidates so ties go to the lower row index
+        double bound = minDistance - dy;
+        if (bestRow >= 0) bound += 1e-6 * siteWidth;
+        int start = row->findNearestFreeRun(cells.originalX[cell], sitesNeeded, bound);
+        if (start < 0) return true;
+
+        double distance = std::abs(row->originX + start * row->siteWidth - cells.originalX[cell]) + dy;
+        if (bestRow < 0 || distance < minDistance || (distance == minDistance && rowIndex < bestRow)) {
+            minDistance = distance;
+            bestRow = rowIndex;
+            bestSite = start;
+        }
+        return true;
+    });
+    return bestRow >= 0;
+}
+
+bool Legalizer::findNearestFreeSpan(int cell, int& bestRow, int& bestSite, double radius) {
+    // Like findNearestFreeSite for a cell covering several rows: candidates are
+    // bottom rows with enough aligned rows above them, and a run must be free in
+    // all of them. Cells covering an even number of rows would have the same rail
+    // at their top and bottom edges, so they only sit on even-ranked rows.
+    int span = rowSpan[cell];
+    int sitesNeeded = static_cast<int>(std::ceil(cells.width[cell] / siteWidth));
+    double minDistance = radius;
+    bestRow = -1;
+    bestSite = -1;
+
+    forEachRowOutward(cells.originalY[cell], [&](int rowIndex, double dy) {
+        if (dy > minDistance) return false;
+        if (spanLimit[rowIndex] < span || (span % 2 == 0 && rowRank[rowIndex] % 2 != 0)) return true;
+        auto& row = rows[rowIndex];
+
+        // Runs further than the remaining horizontal slack are not looked for
+        double target = (cells.originalX[cell] - row->originX) / row->siteWidth;
+        double reach = std::min((minDistance - dy) / row->siteWidth, 2.0 * row->siteCount);
+        int first = static_cast<int>(std::floor(target));
+        int candidates[2] = {lastCommonFreeRun(rowIndex, span, first, static_cast<int>(std::floor(target - reach)), sitesNeeded),
+                             firstCommonFreeRun(rowIndex, span, std::max(first, 0), static_cast<int>(std::ceil(target + reach)), sitesNeeded)};
+        for (int start : candidates) {
+            if (start < 0) continue;
+            double distance = std::abs(row->siteX(start) - cells.originalX[cell]) + dy;
+            if (distance > minDistance) continue;
+            if (bestRow < 0 || distance < minDistance || (distance == minDistance && rowIndex < bestRow)) {
+                minDistance = distance;
+                bestRow = rowIndex;
+                bestSite = start;
+            }
+        }
+        return true;
+    });
+    return bestRow >= 0;
+}
+
+int Legalizer::firstCommonFreeRun(int rowIndex, int span, int from, int to, int sitesNeeded) const {
+    // Leftmost run starting in [from, to] that is free in the span rows starting
+    // at rowIndex; each row can only push the candidate further right
+    int start = from;
+    for (int level = 0; level < span; ) {
+        int next = rows[rowAbove(rowIndex, level)]->findFirstFreeRun(start, sitesNeeded);
+        if (next < 0 || next > to) return -1;
+        if (next != start) {
+            start = next;
+            level = (level == 0) ? 1 : 0;
+        } else {
+            ++level;
+        }
+    }
+    return start;
+}
+
+int Legalizer::lastCommonFreeRun(int rowIndex, int span, int upTo, int downTo, int sitesNeeded) const {
+    // Mirror of firstCommonFreeRun: rightmost run starting in [downTo, upTo]
+    int start = upTo;
+    for (int level = 0; level < span; ) {
+        int next = rows[rowAbove(rowIndex, level)]->findLastFreeRun(start, sitesNeeded);
+        if (next < 0 || next < downTo) return -1;
+        if (next != start) {
+            start = next;
+            level = (level == 0) ? 1 : 0;
+        } else {
+            ++level;
+        }
+    }
+    return start;
+}
+
+void Legalizer::placeAt(int cell, int rowIndex, int site) {
+    // Moves a cell to a site and occupies its footprint in every row it covers
+    int sitesNeeded = static_cast<int>(std::ceil(cells.width[cell] / siteWidth));
+    cells.x[cell] = rows[rowIndex]->siteX(site);
+    cells.y[cell] = rows[rowIndex]->originY;
+    for (int level = 0; level < rowSpan[cell]; ++level) {
+        rows[rowAbove(rowIndex, level)]->occupy(site, sitesNeeded, cell);
+    }
+}
+
+void Legalizer::placeAtNearestSite(int cell) {
+    int rowIndex, siteIndex;
+    if (findNearestFreeSite(cell, rowIndex, siteIndex)) {
+        placeAt(cell, rowIndex, siteIndex);
+    } else {
+        std::cerr << "Failed to find placement for cell: " << cells.name(cell) << std::endl;
+    }
+}
+
+bool Legalizer::placeWithinLimit(int cell) {
+    // Searches windows around the original position that double in size up to
+    // the displacement limit, so a cell with room nearby never scans far
+    double rowHeight = rowsByY.empty() ? siteWidth : rows[rowsByY[0]]->height;
+    double radius = std::min(rowHeight + std::ceil(cells.width[cell] / siteWidth) * siteWidth, displacementLimit);
+    while (true) {
+        int rowIndex, siteIndex;
+        if (findNearestFreeSite(cell, rowIndex, siteIndex, radius)) {
+            placeAt(cell, rowIndex, siteIndex);
+            return true;
+        }
+        if (radius >= displacementLimit) return false;
+        radius = std::min(radius * 2, displacementLimit);
+    }
+}
+
+bool Legalizer::withinLimit(int cell, double x, double y) const {
+    // A move may not take a cell beyond the displacement limit, nor further
+    // beyond it than the cell already is
+    if (displacementLimit <= 0) return true;
+    double moved = std::abs(x - cells.originalX[cell]) + std::abs(y - cells.originalY[cell]);
+    return moved <= displacementLimit ||
+           moved <= std::abs(cells.x[cell] - cells.originalX[cell]) + std::abs(cells.y[cell] - cells.originalY[cell]);
+}
+
 void Legalizer::placeCells() {
-    // Place cells starting from highest density cluster
-    for (auto& cluster : clusters) {
-        for (auto& cell : cluster) {
-            if (cell->isFixed) continue;
-            double minDistance = std::numeric_limits<double>::max();
-            std::shared_ptr<Site> bestSite = nullptr;
+    // Place cells starting from highest density cluster. Multi-row cells go
+    // first, while free runs are still long enough in several rows at once.
+    std::vector<int> order;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (auto& cluster : clusters) {
+            for (auto& cell : cluster) {
+                if (!cells.isFixed[cell] && (rowSpan[cell] > 1) == (pass == 0)) order.push_back(cell);
+            }
+        }
+    }
+    if (displacementLimit <= 0) {
+        for (int cell : order) {
+            placeAtNearestSite(cell);
+        }
+        return;
+    }
 
-            // Scan all rows and sites
+    // With a displacement limit, cells that find no site within it are ripped up
+    // together with everything else and moved to the front of their part of the
+    // order for the next round; multi-row cells stay ahead of single-row ones. In
+    // the last round a cell that misses the limit is placed at the nearest free
+    // site right away, however far, so it still comes before the cells behind it.
+    const int maxRounds = 8;
+    std::vector<char> priority(cells.size(), 0);
+    std::vector<int> deferred;
+    for (int round = 0; round < maxRounds; ++round) {
+        if (round > 0) {
             for (auto& row : rows) {
-                for (auto& site : row->sites) {
-                    if (site->isOccupied) continue;
-                    if ((site->x + cell->width) > (row->originX + row->siteWidth * row->siteCount)) continue;
-
-                    // Checking cell width don't is not Occupied
-                    bool isOccupied = false;
-
-                    for (int i = 0; i < static_cast<int>(std::ceil(cell->width / siteWidth)); ++i) {
-                        if (row->sites[static_cast<int>((site->x - row->originX) / siteWidth) + i]->isOccupied) {
-                            isOccupied = true;
-                            break;
-                        }
-                    }
-
-                    if (isOccupied) continue;
-
-                    double distance = std::abs(site->x - cell->originalX) + std::abs(site->y - cell->originalY);
-                    if (distance < minDistance) {
-                        minDistance = distance;
-                        bestSite = site;
-                    }
+                row->buildSites();
+            }
+            blockFixedCells();
+            for (int cell : deferred) {
+                priority[cell] = 1;
+            }
+            std::stable_partition(order.begin(), order.end(), [&](int cell) { return priority[cell] != 0; });
+            std::stable_partition(order.begin(), order.end(), [&](int cell) { return rowSpan[cell] > 1; });
+        }
+        deferred.clear();
+        bool lastRound = round + 1 == maxRounds;
+        for (int cell : order) {
+            if (placeWithinLimit(cell)) continue;
+            deferred.push_back(cell);
+            if (lastRound) placeAtNearestSite(cell);
+        }
+        if (deferred.empty()) return;
+    }
+    std::cerr << deferred.size() << " cells could not be placed within the maximum displacement" << std::endl;
+}
+
+void Legalizer::placeCellsAbacus() {
+    // Abacus: cells are taken in x order and appended to the row segment where they
+    // end up with the least displacement. Segments are the free runs of a row left
+    // between fixed cells. Each segment is a list of clusters of abutting cells;
+    // a cluster sits at the position minimizing the quadratic displacement of its
+    // cells, and clusters that collide are merged. All positions are in site units.
+    struct AbacusCluster {
+        int firstCell; // Index into the segment's cell list
+        double e;      // Total weight
+        double q;      // Weighted sum of targets, relative to the cluster's left edge
+        int w;         // Width in sites
+        double x;      // Optimal (unsnapped) position
+    };
+    struct AbacusSegment {
+        int row;
+        int start;     // First site
+        int end;       // One past the last site
+        std::vector<int> cells;
+        std::vector<AbacusCluster> clusters;
+        int usedSites = 0;
+    };
+
+    // Multi-row cells are placed first, at their nearest free span, and then
+    // block the rows like fixed cells do
+    std::vector<int> order;
+    std::vector<int> multiRowCells;
+    for (int i = 0; i < cells.size(); ++i) {
+        if (cells.isFixed[i]) continue;
+        (rowSpan[i] > 1 ? multiRowCells : order).push_back(i);
+    }
+    auto byOriginalX = [this](int a, int b) { return cells.originalX[a] < cells.originalX[b]; };
+    std::stable_sort(multiRowCells.begin(), multiRowCells.end(), byOriginalX);
+    std::stable_sort(order.begin(), order.end(), byOriginalX);
+    for (int cell : multiRowCells) {
+        placeAtNearestSite(cell);
+    }
+
+    std::vector<AbacusSegment> segments;
+    std::vector<std::vector<int>> rowSegments(rows.size());
+    for (size_t r = 0; r < rows.size(); ++r) {
+        for (const auto& run : rows[r]->freeSegments()) {
+            rowSegments[r].push_back(static_cast<int>(segments.size()));
+            segments.emplace_back();
+            segments.back().row = static_cast<int>(r);
+            segments.back().start = run.first;
+            segments.back().end = run.second;
+        }
+    }
+
+    std::vector<int> cellSites(cells.size(), 0);
+    for (int index : order) {
+        cellSites[index] = static_cast<int>(std::ceil(cells.width[index] / siteWidth));
+    }
+
+    // Position (in sites) the cell would take if appended to the segment, merging
+    // with preceding clusters as needed; the segment itself is left untouched.
+    auto trialPosition = [&](const AbacusSegment& segment, const std::shared_ptr<Row>& row, int index) {
+        double target = (cells.originalX[index] - row->originX) / row->siteWidth;
+        double e = 1.0;
+        double q = target;
+        int w = cellSites[index];
+        int offset = 0;
+        double x = 0;
+        for (int k = static_cast<int>(segment.clusters.size()) - 1; ; --k) {
+            x = std::min(std::max(q / e, static_cast<double>(segment.start)), static_cast<double>(segment.end - w));
+            if (k < 0) break;
+            const auto& previous = segment.clusters[k];
+            if (previous.x + previous.w <= x) break;
+            q = previous.q + q - e * previous.w;
+            e += previous.e;
+            offset += previous.w;
+            w += previous.w;
+        }
+        return std::floor(x + 0.5) + offset;
+    };
+
+    for (int cell : order) {
+        int sitesNeeded = cellSites[cell];
+        double minDistance = std::numeric_limits<double>::max();
+        int bestRow = -1;
+        int bestSegment = -1;
+
+        forEachRowOutward(cells.originalY[cell], [&](int rowIndex, double dy) {
+            if (dy > minDistance) return false;
+            auto& row = rows[rowIndex];
+            for (int s : rowSegments[rowIndex]) {
+                const auto& segment = segments[s];
+                if (segment.usedSites + sitesNeeded > segment.end - segment.start) continue;
+
+                double position = trialPosition(segment, row, cell);
+                double distance = std::abs(row->originX + position * row->siteWidth - cells.originalX[cell]) + dy;
+                if (distance < minDistance || (distance == minDistance && rowIndex < bestRow)) {
+                    minDistance = distance;
+                    bestRow = rowIndex;
+                    bestSegment = s;
                 }
             }
+            return true;
+        });
+
+        if (bestSegment < 0) {
+            std::cerr << "Failed to find placement for cell: " << cells.name(cell) << std::endl;
+            continue;
+        }
+
+        // Append the cell to the chosen segment and collapse clusters
+        auto& segment = segments[bestSegment];
+        auto& row = rows[bestRow];
+        double target = (cells.originalX[cell] - row->originX) / row->siteWidth;
+        segment.cells.push_back(cell);
+        segment.usedSites += sitesNeeded;
+        AbacusCluster cluster = {static_cast<int>(segment.cells.size()) - 1, 1.0, target, sitesNeeded, 0};
+        while (true) {
+            cluster.x = std::min(std::max(cluster.q / cluster.e, static_cast<double>(segment.start)),
+                                 static_cast<double>(segment.end - cluster.w));
+            if (segment.clusters.empty()) break;
+            const auto& previous = segment.clusters.back();
+            if (previous.x + previous.w <= cluster.x) break;
+            AbacusCluster merged = previous;
+            merged.q += cluster.q - cluster.e * merged.w;
+            merged.e += cluster.e;
+            merged.w += cluster.w;
+            cluster = merged;
+            segment.clusters.pop_back();
+        }
+        segment.clusters.push_back(cluster);
+    }
+
+    // Snap clusters to the site grid and commit positions and site occupancy
+    for (auto& segment : segments) {
+        auto& row = rows[segment.row];
+        for (size_t k = 0; k < segment.clusters.size(); ++k) {
+            const auto& cluster = segment.clusters[k];
+            int end = (k + 1 < segment.clusters.size()) ? segment.clusters[k + 1].firstCell
+                                                        : static_cast<int>(segment.cells.size());
+            int site = static_cast<int>(std::floor(cluster.x + 0.5));
+            for (int c = cluster.firstCell; c < end; ++c) {
+                int cell = segment.cells[c];
+                cells.x[cell] = row->siteX(site);
+                cells.y[cell] = row->originY;
+                row->occupy(site, cellSites[cell], cell);
+                site += cellSites[cell];
+            }
+        }
+    }
+}
+
+void Legalizer::placeCellsTetris() {
+    // Tetris: cells are taken in x order and packed against a per-row frontier,
+    // choosing the row where the cell lands closest to its original position.
+    // Nothing left of a frontier is ever reconsidered, which keeps it O(n log n).
+    // Multi-row cells are placed beforehand, at their nearest free span.
+    std::vector<int> frontier(rows.size(), 0);
+
+    std::vector<int> order;
+    std::vector<int> multiRowCells;
+    for (int i = 0; i < cells.size(); ++i) {
+        if (cells.isFixed[i]) continue;
+        (rowSpan[i] > 1 ? multiRowCells : order).push_back(i);
+    }
+    auto byOriginalX = [this](int a, int b) { return cells.originalX[a] < cells.originalX[b]; };
+    std::stable_sort(multiRowCells.begin(), multiRowCells.end(), byOriginalX);
+    std::stable_sort(order.begin(), order.end(), byOriginalX);
+    for (int cell : multiRowCells) {
+        placeAtNearestSite(cell);
+    }
+
+    for (int cell : order) {
+        int sitesNeeded = static_cast<int>(std::ceil(cells.width[cell] / siteWidth));
+        double minDistance = std::numeric_limits<double>::max();
+        int bestRow = -1;
+        int bestSite = -1;
+
+        forEachRowOutward(cells.originalY[cell], [&](int rowIndex, double dy) {
+            if (dy > minDistance) return false;
+            auto& row = rows[rowIndex];
+            int target = static_cast<int>(std::floor((cells.originalX[cell] - row->originX) / row->siteWidth + 0.5));
+            // Right of the frontier only fixed and multi-row cells can be in the way
+            int site = row->findFirstFreeRun(std::max(frontier[rowIndex], target), sitesNeeded);
+            if (site < 0) {
+                site = row->siteCount - sitesNeeded;
+                if (site < frontier[rowIndex] || row->findFirstFreeRun(site, sitesNeeded) != site) return true;
+            }
+            double distance = std::abs(row->originX + site * row->siteWidth - cells.originalX[cell]) + dy;
+            if (distance < minDistance || (distance == minDistance && rowIndex < bestRow)) {
+                minDistance = distance;
+                bestRow = rowIndex;
+                bestSite = site;
+            }
+            return true;
+        });
+
+        // Every frontier is too far right: fall back to the gaps left behind them
+        if (bestRow < 0 && !findNearestFreeSite(cell, bestRow, bestSite)) {
+            std::cerr << "Failed to find placement for cell: " << cells.name(cell) << std::endl;
+            continue;
+        }
+
+        placeAt(cell, bestRow, bestSite);
+        frontier[bestRow] = std::max(frontier[bestRow], bestSite + sitesNeeded);
+    }
+}
+
+int Legalizer::placeCellsIncremental(const std::vector<double>& baselineX, const std::vector<double>& baselineY,
+                                     const std::vector<char>& listed) {
+    // ECO legalization against an earlier legal placement. A cell whose input
+    // position equals its baseline position is unchanged and is pinned there
+    // if that spot is on the site grid and still free. Moved and new cells,
+    // and unchanged cells that collide with ones pinned before them, are placed
+    // at the nearest free site. Returns the number of cells placed that way.
+    std::vector<int> ripped;
+    for (int cell : allCells) {
+        bool pinned = false;
+        if (listed[cell] && baselineX[cell] == cells.originalX[cell] && baselineY[cell] == cells.originalY[cell]) {
+            int rowIndex = rowIndexAt(cells.originalY[cell]);
+            if (rowIndex >= 0) {
+                const auto& row = rows[rowIndex];
+                double site = (cells.originalX[cell] - row->originX) / row->siteWidth;
+                int siteIndex = static_cast<int>(std::floor(site + 0.5));
+                if (std::abs(site - siteIndex) <= 1e-6 && isFree(rowIndex, siteIndex, cell)) {
+                    placeAt(cell, rowIndex, siteIndex);
+                    pinned = true;
+                }
+            }
+        }
+        if (!pinned) ripped.push_back(cell);
+    }
+
+    // Multi-row cells first, as in the other modes
+    std::stable_sort(ripped.begin(), ripped.end(), [this](int a, int b) {
+        return rowSpan[a] > rowSpan[b] || (rowSpan[a] == rowSpan[b] && cells.originalX[a] < cells.originalX[b]);
+    });
+    for (int cell : ripped) {
+        if (displacementLimit > 0 && placeWithinLimit(cell)) continue;
+        placeAtNearestSite(cell);
+    }
+    return static_cast<int>(ripped.size());
+}
+
+bool Legalizer::isFree(int rowIndex, int site, int cell) const {
+    // Whether cell could sit at site of the row: inside the rows it would cover,
+    // on a row of the right parity, and with all of its sites free
+    int span = rowSpan[cell];
+    int sitesNeeded = static_cast<int>(std::ceil(cells.width[cell] / siteWidth));
+    if (site < 0 || spanLimit[rowIndex] < span || (span % 2 == 0 && rowRank[rowIndex] % 2 != 0)) return false;
+    for (int level = 0; level < span; ++level) {
+        const auto& row = rows[rowAbove(rowIndex, level)];
+        if (site + sitesNeeded > row->siteCount) return false;
+        for (int i = site; i < site + sitesNeeded; ++i) {
+            if (row->isOccupied(i)) return false;
+        }
+    }
+    return true;
+}
+
+void Legalizer::refineAssignment() {
+    // Cells of the same footprint (sites and rows covered) can trade slots
+    // freely. Inside each window of the row/site grid, the cells of every
+    // footprint are matched to their own slots at minimum total displacement
+    // with the Hungarian algorithm. Windows are disjoint, so they are solved in
+    // parallel; the second pass shifts the grid by half a window so cells can
+    // cross the edges of the first.
+    const int windowRows = 16;
+    const int windowSites = 512;
+    const int maxGroupSize = 128; // Bounds the O(n^3) solve; larger groups are split in x order
+
+    struct Slot {
+        long long window;
+        int sites;
+        int span;
+        double x;
+        double y;
+        int cell;
+        int row;
+        int site;
+        bool operator<(const Slot& other) const {
+            if (window != other.window) return window < other.window;
+            if (sites != other.sites) return sites < other.sites;
+            if (span != other.span) return span < other.span;
+            if (x != other.x) return x < other.x;
+            return cell < other.cell;
+        }
+    };
+
+    long long windowColumns = 2;
+    for (const auto& row : rows) {
+        windowColumns = std::max(windowColumns, static_cast<long long>(row->siteCount / windowSites + 2));
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        int rowOffset = pass * windowRows / 2;
+        int siteOffset = pass * windowSites / 2;
+        std::vector<Slot> slots;
+        for (int cell : allCells) {
+            int rowIndex, siteIndex;
+            if (!locateCell(cell, rowIndex, siteIndex)) continue;
+            long long window = static_cast<long long>((rowRank[rowIndex] + rowOffset) / windowRows) * windowColumns +
+                               (siteIndex + siteOffset) / windowSites;
+            slots.push_back({window, static_cast<int>(std::ceil(cells.width[cell] / siteWidth)), rowSpan[cell],
+                             cells.x[cell], cells.y[cell], cell, rowIndex, siteIndex});
+        }
+        std::sort(slots.begin(), slots.end());
+
+        // Groups are runs of equal window and footprint, cut to the size limit
+        std::vector<std::pair<int, int>> groups;
+        for (size_t begin = 0; begin < slots.size(); ) {
+            size_t end = begin + 1;
+            while (end < slots.size() && end - begin < static_cast<size_t>(maxGroupSize) &&
+                   slots[end].window == slots[begin].window && slots[end].sites == slots[begin].sites &&
+                   slots[end].span == slots[begin].span) {
+                ++end;
+            }
+            if (end - begin > 1) groups.emplace_back(static_cast<int>(begin), static_cast<int>(end));
+            begin = end;
+        }
 
-            if (bestSite) {
-                cell->x = bestSite->x;
-                cell->y = bestSite->y;
-                bestSite->isOccupied = true;
-                bestSite->cell = cell;
-                // Occupy subsequent sites if cell width > site width
-                int sitesNeeded = static_cast<int>(std::ceil(cell->width / siteWidth));
-
-                // Find the correct row for the cell
-                std::shared_ptr<Row> row = nullptr;
-                for (auto& r : rows) {
-                    if (r->originY == bestSite->y) {
-                        row = r;
-                        break;
-                    }
+        Utilities::parallelFor(static_cast<int>(groups.size()), threadCount, [&](int g) {
+            int begin = groups[g].first;
+            int n = groups[g].second - begin;
+            std::vector<double> cost(static_cast<size_t>(n) * n);
+            for (int i = 0; i < n; ++i) {
+                const Slot& from = slots[begin + i];
+                for (int j = 0; j < n; ++j) {
+                    const Slot& to = slots[begin + j];
+                    // Slots out of the displacement limit are priced out rather than removed
+                    double moved = std::abs(to.x - cells.originalX[from.cell]) + std::abs(to.y - cells.originalY[from.cell]);
+                    if (!withinLimit(from.cell, to.x, to.y)) moved += 1e12;
+                    cost[static_cast<size_t>(i) * n + j] = moved;
+                }
+            }
+            std::vector<int> slotOf = Assignment::solve(n, cost);
+            for (int i = 0; i < n; ++i) {
+                int cell = slots[begin + i].cell;
+                const Slot& to = slots[begin + slotOf[i]];
+                cells.x[cell] = to.x;
+                cells.y[cell] = to.y;
+                for (int level = 0; level < to.span; ++level) {
+                    auto& siteCells = rows[rowAbove(to.row, level)]->siteCells;
+                    std::fill(siteCells.begin() + to.site, siteCells.begin() + to.site + to.sites, cell);
                 }
+            }
+        });
+    }
+}
 
-                int siteIndex = static_cast<int>((bestSite->x - row->originX) / siteWidth);
-                for (int i = 0; i < sitesNeeded; ++i) {
-                    if (siteIndex + i < static_cast<int>(row->sites.size())) {
-                        row->sites[siteIndex + i]->isOccupied = true;
-                        row->sites[siteIndex + i]->cell = cell;
-                    }
+void Legalizer::refineRows() {
+    // Re-solves the placement of each row segment in its current cell order.
+    // Segments are bounded by fixed and multi-row cells, which stay put, so
+    // rows are independent and are solved in parallel.
+    std::vector<int> skipped(rows.size(), 0);
+    Utilities::parallelFor(static_cast<int>(rows.size()), threadCount, [&](int rowIndex) {
+        const auto& row = rows[rowIndex];
+        std::vector<int> segmentCells;
+        int start = 0;
+        int previous = -1;
+        bool previousBlocks = false;
+        for (int site = 0; site <= row->siteCount; ++site) {
+            int owner = (site < row->siteCount) ? row->siteCells[site] : -1;
+            if (site > 0 && site < row->siteCount && owner == previous) continue;
+            bool blocks = site == row->siteCount || (owner >= 0 && (cells.isFixed[owner] || rowSpan[owner] > 1));
+            if (blocks) {
+                if (!segmentCells.empty() && !shiftSegment(rowIndex, start, site, segmentCells)) {
+                    ++skipped[rowIndex];
                 }
+                segmentCells.clear();
             } else {
-                std::cerr << "Failed to find placement for cell: " << cell->name << std::endl;
+                if (previousBlocks) start = site;
+                if (owner >= 0) segmentCells.push_back(owner);
+            }
+            previous = owner;
+            previousBlocks = blocks;
+        }
+    });
+
+    int skippedSegments = std::accumulate(skipped.begin(), skipped.end(), 0);
+    if (skippedSegments > 0) {
+        std::cerr << skippedSegments << " row segments were too large to shift and were left as placed" << std::endl;
+    }
+}
+
+bool Legalizer::shiftSegment(int rowIndex, int start, int end, const std::vector<int>& segmentCells) {
+    // Dynamic program over the slack of the segment. With S_i the width of the
+    // cells left of cell i, cell i sits at start + S_i + y_i and keeping the order
+    // only requires y_0 <= y_1 <= ... <= slack. cost[y] is the least displacement
+    // of cells 0..i with y_i = y; each step adds cell i's own displacement to the
+    // prefix minimum of the previous step, remembering where that minimum was.
+    // Returns false if the segment's table is too large to solve.
+    auto& row = rows[rowIndex];
+    int n = static_cast<int>(segmentCells.size());
+    std::vector<int> offsets(n);
+    int usedSites = 0;
+    for (int i = 0; i < n; ++i) {
+        offsets[i] = usedSites;
+        usedSites += static_cast<int>(std::ceil(cells.width[segmentCells[i]] / siteWidth));
+    }
+    int slack = end - start - usedSites;
+    const size_t maxTableSize = size_t(1) << 24;
+    if (slack < 0) return true;
+    if (static_cast<size_t>(n) * (slack + 1) > maxTableSize) return false;
+
+    auto cellCost = [&](int i, int y) {
+        int cell = segmentCells[i];
+        double x = row->siteX(start + offsets[i] + y);
+        double cost = std::abs(x - cells.originalX[cell]);
+        if (!withinLimit(cell, x, row->originY)) cost += 1e12;
+        return cost;
+    };
+
+    std::vector<double> cost(slack + 1);
+    std::vector<int> choice(static_cast<size_t>(n) * (slack + 1));
+    for (int y = 0; y <= slack; ++y) {
+        cost[y] = cellCost(0, y);
+    }
+    for (int i = 1; i < n; ++i) {
+        double bestCost = cost[0];
+        int bestY = 0;
+        int* previousY = &choice[static_cast<size_t>(i) * (slack + 1)];
+        for (int y = 0; y <= slack; ++y) {
+            if (cost[y] < bestCost) {
+                bestCost = cost[y];
+                bestY = y;
             }
+            previousY[y] = bestY;
+            cost[y] = bestCost + cellCost(i, y);
         }
     }
+
+    double currentCost = 0;
+    for (int cell : segmentCells) {
+        currentCost += std::abs(cells.x[cell] - cells.originalX[cell]);
+    }
+    int y = static_cast<int>(std::min_element(cost.begin(), cost.end()) - cost.begin());
+    if (cost[y] >= currentCost - 1e-9 * siteWidth) return true;
+
+    std::vector<int> sites(n);
+    for (int i = n - 1; i >= 0; --i) {
+        sites[i] = start + offsets[i] + y;
+        y = choice[static_cast<size_t>(i) * (slack + 1) + y];
+    }
+    for (int cell : segmentCells) {
+        int siteIndex = static_cast<int>(std::floor((cells.x[cell] - row->originX) / row->siteWidth + 0.5));
+        row->release(siteIndex, static_cast<int>(std::ceil(cells.width[cell] / siteWidth)));
+    }
+    for (int i = 0; i < n; ++i) {
+        int cell = segmentCells[i];
+        cells.x[cell] = row->siteX(sites[i]);
+        row->occupy(sites[i], static_cast<int>(std::ceil(cells.width[cell] / siteWidth)), cell);
+    }
+    return true;
 }
 
 void Legalizer::simulatedAnnealing(double maxDurationMinutes) {
     // Convert maxDurationMinutes to milliseconds
     auto maxDuration = std::chrono::milliseconds(static_cast<int>(maxDurationMinutes * 60 * 1000));
     auto startTime = std::chrono::steady_clock::now();
+    auto deadline = startTime + maxDuration;
+
+    // Net boxes are shared by every cell on a net, so with a wirelength term
+    // the passes run on one thread
+    int annealThreads = threadCount;
+    if (wirelengthWeight > 0) {
+        wirelengthCache->build();
+        annealThreads = 1;
+    }
+    auto totalCost = [this]() {
+        double cost = calculateTotalDisplacement(allCells);
+        if (wirelengthWeight > 0) cost += wirelengthWeight * wirelengthCache->total();
+        return cost;
+    };
 
     // Initialize best global solution
     std::vector<std::pair<double, double>> bestPositionsGlobal;
-    double bestTotalDisplacementGlobal = calculateTotalDisplacement(cells);
-    for (const auto& cell : cells) {
-        bestPositionsGlobal.emplace_back(cell->x, cell->y);
+    double bestTotalDisplacementGlobal = totalCost();
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        bestPositionsGlobal.emplace_back(cells.x[cell], cells.y[cell]);
     }
 
     int totalProgress = static_cast<int>(maxDurationMinutes * 60);
     int currentProgress = 0;
+    unsigned firstPass = passCount;
+    int convergedPass = 0;
 
     while (true) {
         // Check if time limit has been reached
@@ -217,244 +1011,510 @@ void Legalizer::simulatedAnnealing(double maxDurationMinutes) {
 
         // Progress bar
         auto elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime).count();
-        if (elapsedTime > currentProgress) {
-            currentProgress = static_cast<int>(elapsedTime);
-            int width = 50;
-            int pos = (currentProgress * width) / totalProgress;
-            std::cout << "[";
-            for (int i = 0; i < width; ++i) {
-                if (i < pos) std::cout << "=";
-                else if (i == pos) std::cout << ">";
-                else std::cout << " ";
+        printProgress(static_cast<int>(elapsedTime), totalProgress, currentProgress);
+
+        // Simulated annealing within each cluster. Clusters are disjoint and their
+        // swaps only exchange equal footprints, so they can be annealed concurrently;
+        // each one gets its own generator seeded from the pass and cluster index.
+        unsigned pass = passCount++;
+        Utilities::parallelFor(static_cast<int>(clusters.size()), annealThreads, [&](int clusterIndex) {
+            annealCluster(clusters[clusterIndex], pass * static_cast<unsigned>(clusters.size()) + clusterIndex, deadline);
+        });
+
+        // Global simulated annealing. With several threads the rows are split into
+        // horizontal bands annealed concurrently; band boundaries shift by half a
+        // band on odd passes so cells can still migrate across them.
+        if (annealThreads > 1) {
+            annealBands(pass, deadline);
+        } else {
+            std::default_random_engine generator(std::random_device{}());
+            annealCells(allCells, generator, false, deadline);
+        }
+
+        // Update the best solution across all iterations; a pass that gains less
+        // than the minimum relative gain ends the run early
+        double currentTotalDisplacementGlobal = totalCost();
+        bool converged = minRelativeGain > 0 &&
+                         bestTotalDisplacementGlobal - currentTotalDisplacementGlobal < minRelativeGain * bestTotalDisplacementGlobal;
+        if (currentTotalDisplacementGlobal < bestTotalDisplacementGlobal) {
+            bestTotalDisplacementGlobal = currentTotalDisplacementGlobal;
+            for (int i = 0; i < cells.size(); ++i) {
+                bestPositionsGlobal[i].first = cells.x[i];
+                bestPositionsGlobal[i].second = cells.y[i];
             }
-            std::cout << "] " << (currentProgress * 100) / totalProgress << "%\r";
-            std::cout.flush();
+        } else {
+            // Restore the best global solution
+            restorePositions(bestPositionsGlobal);
+            if (wirelengthWeight > 0) wirelengthCache->build();
         }
+        if (converged) {
+            convergedPass = static_cast<int>(pass - firstPass) + 1;
+            break;
+        }
+    }
 
-        // Simulated annealing within each cluster
-        for (auto& cluster : clusters) {
-            double temperature = 1000.0;
-            double coolingRate = 0.99; // Adjusted cooling rate for better convergence
+    // After time limit, ensure the best global solution is restored
+    restorePositions(bestPositionsGlobal);
 
-            std::default_random_engine generator(std::random_device{}());
-            std::uniform_real_distribution<double> probability(0.0, 1.0);
+    std::cout << "[==================================================] 100%" << std::endl;
+    if (convergedPass > 0) {
+        std::cout << "Converged after " << convergedPass << " passes" << std::endl;
+    }
+}
 
-            // Initialize best solution for the cluster
-            std::vector<std::pair<double, double>> bestPositionsCluster;
-            double bestTotalDisplacementCluster = calculateTotalDisplacement(cluster);
-            for (const auto& cell : cluster) {
-                bestPositionsCluster.emplace_back(cell->x, cell->y);
-            }
+void Legalizer::restorePositions(const std::vector<std::pair<double, double>>& positions) {
+    // Moves every cell that differs from the saved state back to it. All of their
+    // footprints are released before any is occupied again, so the site grid
+    // follows the positions even when cells of different widths traded places.
+    std::vector<int> moved;
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        if (cells.x[cell] != positions[cell].first || cells.y[cell] != positions[cell].second) {
+            moved.push_back(cell);
+        }
+    }
+    for (int cell : moved) {
+        int rowIndex, siteIndex;
+        if (!locateCell(cell, rowIndex, siteIndex)) continue;
+        int sites = static_cast<int>(std::ceil(cells.width[cell] / siteWidth));
+        for (int level = 0; level < rowSpan[cell]; ++level) {
+            rows[rowAbove(rowIndex, level)]->release(siteIndex, sites);
+        }
+    }
+    for (int cell : moved) {
+        cells.x[cell] = positions[cell].first;
+        cells.y[cell] = positions[cell].second;
+        int rowIndex = rowIndexAt(cells.y[cell]);
+        if (rowIndex < 0) continue;
+        const auto& row = rows[rowIndex];
+        int siteIndex = static_cast<int>(std::floor((cells.x[cell] - row->originX) / row->siteWidth + 0.5));
+        if (siteIndex < 0 || siteIndex >= row->siteCount) continue;
+        placeAt(cell, rowIndex, siteIndex);
+    }
+}
 
-            while (temperature > 1) {
-                for (int iter = 0; iter < 1000; ++iter) {
-                    attemptSwap(cluster, temperature, generator, probability);
-
-                    // Calculate current total displacement
-                    double currentTotalDisplacement = calculateTotalDisplacement(cluster);
-                    if (currentTotalDisplacement < bestTotalDisplacementCluster) {
-                        // Update best solution for the cluster
-                        bestTotalDisplacementCluster = currentTotalDisplacement;
-                        for (size_t i = 0; i < cluster.size(); ++i) {
-                            bestPositionsCluster[i].first = cluster[i]->x;
-                            bestPositionsCluster[i].second = cluster[i]->y;
-                        }
-                    }
-                }
-                temperature *= coolingRate;
-            }
+void Legalizer::printProgress(int elapsedSeconds, int totalSeconds, int& currentProgress) {
+    if (elapsedSeconds <= currentProgress || totalSeconds <= 0) return;
+    currentProgress = elapsedSeconds;
+    int width = 50;
+    int pos = std::min((currentProgress * width) / totalSeconds, width);
+    std::cout << "[";
+    for (int i = 0; i < width; ++i) {
+        if (i < pos) std::cout << "=";
+        else if (i == pos) std::cout << ">";
+        else std::cout << " ";
+    }
+    std::cout << "] " << std::min((currentProgress * 100) / totalSeconds, 100) << "%\r";
+    std::cout.flush();
+}
 
-            // Restore best solution for the cluster
-            for (size_t i = 0; i < cluster.size(); ++i) {
-                cluster[i]->x = bestPositionsCluster[i].first;
-                cluster[i]->y = bestPositionsCluster[i].second;
-            }
+void Legalizer::parallelTempering(double maxDurationMinutes, int replicaCount) {
+    // Replica exchange: K copies of the placement are annealed concurrently at fixed
+    // temperatures spread geometrically over the usual 1000 -> 1 range, and neighbouring
+    // replicas periodically trade states. Replicas only permute cells between slots of
+    // the same footprint, which is always legal, so a replica is just a pair of
+    // position arrays rather than a copy of the cell graph and site grid.
+    auto maxDuration = std::chrono::milliseconds(static_cast<int>(maxDurationMinutes * 60 * 1000));
+    auto startTime = std::chrono::steady_clock::now();
+    replicaCount = std::max(2, replicaCount);
+
+    // Group placed movable cells by the number of sites and rows they cover
+    std::vector<int> pool;
+    std::vector<int> groupOf;
+    std::vector<std::vector<int>> groups;
+    std::map<std::pair<int, int>, int> groupByFootprint;
+    for (int i = 0; i < cells.size(); ++i) {
+        int rowIndex, siteIndex;
+        if (cells.isFixed[i] || !locateCell(static_cast<int>(i), rowIndex, siteIndex)) continue;
+        std::pair<int, int> footprint(static_cast<int>(std::ceil(cells.width[i] / siteWidth)), rowSpan[i]);
+        auto it = groupByFootprint.find(footprint);
+        if (it == groupByFootprint.end()) {
+            it = groupByFootprint.emplace(footprint, static_cast<int>(groups.size())).first;
+            groups.emplace_back();
         }
+        groupOf.push_back(it->second);
+        groups[it->second].push_back(static_cast<int>(pool.size()));
+        pool.push_back(static_cast<int>(i));
+    }
 
-        // Global simulated annealing
-        double temperature = 1000.0;
-        double coolingRate = 0.99;
-
-        std::default_random_engine generator(std::random_device{}());
-        std::uniform_real_distribution<double> probability(0.0, 1.0);
-
-        // Initialize best solution for global SA
-        std::vector<std::pair<double, double>> bestPositions;
-        double bestTotalDisplacement = calculateTotalDisplacement(cells);
-        for (const auto& cell : cells) {
-            bestPositions.emplace_back(cell->x, cell->y);
-        }
-
-        while (temperature > 1) {
-            for (int iter = 0; iter < 1000; ++iter) {
-                attemptSwapGlobal(temperature, generator, probability);
-
-                // Calculate current total displacement
-                double currentTotalDisplacement = calculateTotalDisplacement(cells);
-                if (currentTotalDisplacement < bestTotalDisplacement) {
-                    // Update best global solution
-                    bestTotalDisplacement = currentTotalDisplacement;
-                    for (size_t i = 0; i < cells.size(); ++i) {
-                        bestPositions[i].first = cells[i]->x;
-                        bestPositions[i].second = cells[i]->y;
-                    }
+    std::vector<int> movers;
+    for (size_t p = 0; p < pool.size(); ++p) {
+        if (groups[groupOf[p]].size() > 1) movers.push_back(static_cast<int>(p));
+    }
+    if (movers.empty()) return;
+
+    std::vector<double> originalX(pool.size()), originalY(pool.size());
+    for (size_t p = 0; p < pool.size(); ++p) {
+        originalX[p] = cells.originalX[pool[p]];
+        originalY[p] = cells.originalY[pool[p]];
+    }
+
+    struct Replica {
+        std::vector<double> x;
+        std::vector<double> y;
+        double energy;
+    };
+    Replica initial;
+    initial.energy = 0;
+    for (size_t p = 0; p < pool.size(); ++p) {
+        initial.x.push_back(cells.x[pool[p]]);
+        initial.y.push_back(cells.y[pool[p]]);
+        initial.energy += std::abs(initial.x[p] - originalX[p]) + std::abs(initial.y[p] - originalY[p]);
+    }
+    std::vector<Replica> replicas(replicaCount, initial);
+    Replica best = initial;
+
+    // Replica 0 is the coldest; states move between temperatures, temperatures stay put
+    std::vector<double> temperatures(replicaCount);
+    for (int r = 0; r < replicaCount; ++r) {
+        temperatures[r] = std::pow(1000.0, static_cast<double>(r) / (replicaCount - 1));
+    }
+
+    int movesPerRound = std::max(1000, static_cast<int>(movers.size()));
+    std::default_random_engine exchangeGenerator(0);
+    std::uniform_real_distribution<double> probability(0.0, 1.0);
+    int totalProgress = static_cast<int>(maxDurationMinutes * 60);
+    int currentProgress = 0;
+
+    for (unsigned round = 0; ; ++round) {
+        auto currentTime = std::chrono::steady_clock::now();
+        if (currentTime - startTime >= maxDuration) break;
+        auto elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime).count();
+        printProgress(static_cast<int>(elapsedTime), totalProgress, currentProgress);
+
+        Utilities::parallelFor(replicaCount, threadCount, [&](int r) {
+            std::seed_seq seedSequence{round, static_cast<unsigned>(r), 2u};
+            std::default_random_engine generator(seedSequence);
+            std::uniform_real_distribution<double> acceptance(0.0, 1.0);
+            std::uniform_int_distribution<int> pickMover(0, static_cast<int>(movers.size()) - 1);
+            auto& replica = replicas[r];
+
+            for (int move = 0; move < movesPerRound; ++move) {
+                int p = movers[pickMover(generator)];
+                const auto& group = groups[groupOf[p]];
+                int q = group[std::uniform_int_distribution<int>(0, static_cast<int>(group.size()) - 1)(generator)];
+                if (p == q) continue;
+
+                if (displacementLimit > 0) {
+                    double oldP = std::abs(replica.x[p] - originalX[p]) + std::abs(replica.y[p] - originalY[p]);
+                    double oldQ = std::abs(replica.x[q] - originalX[q]) + std::abs(replica.y[q] - originalY[q]);
+                    double newP = std::abs(replica.x[q] - originalX[p]) + std::abs(replica.y[q] - originalY[p]);
+                    double newQ = std::abs(replica.x[p] - originalX[q]) + std::abs(replica.y[p] - originalY[q]);
+                    if (newP > std::max(displacementLimit, oldP) || newQ > std::max(displacementLimit, oldQ)) continue;
                 }
+
+                double oldDistance = std::abs(replica.x[p] - originalX[p]) + std::abs(replica.y[p] - originalY[p]) +
+                                     std::abs(replica.x[q] - originalX[q]) + std::abs(replica.y[q] - originalY[q]);
+                double newDistance = std::abs(replica.x[q] - originalX[p]) + std::abs(replica.y[q] - originalY[p]) +
+                                     std::abs(replica.x[p] - originalX[q]) + std::abs(replica.y[p] - originalY[q]);
+                if (!acceptMove(oldDistance, newDistance, temperatures[r], acceptance(generator))) continue;
+
+                std::swap(replica.x[p], replica.x[q]);
+                std::swap(replica.y[p], replica.y[q]);
+                replica.energy += newDistance - oldDistance;
             }
-            temperature *= coolingRate;
-        }
+        });
 
-        // Restore best global solution
-        for (size_t i = 0; i < cells.size(); ++i) {
-            cells[i]->x = bestPositions[i].first;
-            cells[i]->y = bestPositions[i].second;
+        for (const auto& replica : replicas) {
+            if (replica.energy < best.energy) best = replica;
         }
 
-        // Update the best solution across all iterations
-        double currentTotalDisplacementGlobal = calculateTotalDisplacement(cells);
-        if (currentTotalDisplacementGlobal < bestTotalDisplacementGlobal) {
-            bestTotalDisplacementGlobal = currentTotalDisplacementGlobal;
-            for (size_t i = 0; i < cells.size(); ++i) {
-                bestPositionsGlobal[i].first = cells[i]->x;
-                bestPositionsGlobal[i].second = cells[i]->y;
-            }
-        } else {
-            // Restore the best global solution
-            for (size_t i = 0; i < cells.size(); ++i) {
-                cells[i]->x = bestPositionsGlobal[i].first;
-                cells[i]->y = bestPositionsGlobal[i].second;
+        // Exchange neighbouring states, alternating even and odd pairs each round
+        for (int r = round % 2; r + 1 < replicaCount; r += 2) {
+            double exponent = (1.0 / temperatures[r] - 1.0 / temperatures[r + 1]) *
+                              (replicas[r].energy - replicas[r + 1].energy);
+            if (exponent >= 0 || probability(exchangeGenerator) < std::exp(exponent)) {
+                std::swap(replicas[r], replicas[r + 1]);
             }
         }
     }
 
-    // After time limit, ensure the best global solution is restored
-    for (size_t i = 0; i < cells.size(); ++i) {
-        cells[i]->x = bestPositionsGlobal[i].first;
-        cells[i]->y = bestPositionsGlobal[i].second;
+    // Commit the best state; footprints are only permuted, so overwriting the
+    // back-pointers of every new footprint leaves the site grid consistent
+    for (size_t p = 0; p < pool.size(); ++p) {
+        int cell = pool[p];
+        cells.x[cell] = best.x[p];
+        cells.y[cell] = best.y[p];
+        int rowIndex = rowIndexAt(cells.y[cell]);
+        int siteIndex = static_cast<int>(std::floor((cells.x[cell] - rows[rowIndex]->originX) / rows[rowIndex]->siteWidth + 0.5));
+        int sites = static_cast<int>(std::ceil(cells.width[cell] / siteWidth));
+        for (int level = 0; level < rowSpan[cell]; ++level) {
+            auto& row = rows[rowAbove(rowIndex, level)];
+            for (int i = siteIndex; i < siteIndex + sites && i < row->siteCount; ++i) {
+                row->siteCells[i] = cell;
+            }
+        }
     }
 
     std::cout << "[==================================================] 100%" << std::endl;
 }
 
-void Legalizer::attemptSwap(std::vector<std::shared_ptr<Cell>>& cluster, double temperature,
-                            std::default_random_engine& generator,
-                            std::uniform_real_distribution<double>& probability) {
-    std::uniform_int_distribution<int> cell_distribution(0, cluster.size() - 1);
-
-    int idx1 = cell_distribution(generator);
-    int idx2 = cell_distribution(generator);
-    if (idx1 == idx2) return;
-
-    auto& cell1 = cluster[idx1];
-    auto& cell2 = cluster[idx2];
+void Legalizer::annealCluster(std::vector<int>& cluster, unsigned seed,
+                              std::chrono::steady_clock::time_point deadline) {
+    std::seed_seq seedSequence{seed};
+    std::default_random_engine generator(seedSequence);
+    // Keep to cells covering the same number of sites, so a swap only ever touches
+    // the cluster's own sites and clusters can be annealed in parallel
+    annealCells(cluster, generator, true, deadline);
+}
 
-    // Only allow swapping cells if widths are equal
-    if (std::abs(cell1->width - cell2->width) > siteWidth * 0.1) {
-        return;
+void Legalizer::annealBands(unsigned pass, std::chrono::steady_clock::time_point deadline) {
+    int rowCount = static_cast<int>(rowsByY.size());
+    int bandHeight = std::max(1, (rowCount + threadCount - 1) / threadCount);
+    int offset = (pass % 2 == 1) ? bandHeight / 2 : 0;
+    int bandCount = (rowCount - offset + bandHeight - 1) / bandHeight + (offset > 0 ? 1 : 0);
+
+    // Rows belong to exactly one band, so a swap between two cells of a band
+    // only reads and writes sites of that band. Multi-row cells straddling a band
+    // boundary sit out the pass; the boundaries move on the next one.
+    auto bandOf = [&](int rank) {
+        return (rank < offset) ? 0 : (rank - offset) / bandHeight + (offset > 0 ? 1 : 0);
+    };
+    std::vector<std::vector<int>> bands(bandCount);
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        if (cells.isFixed[cell]) continue;
+        int rowIndex, siteIndex;
+        if (!locateCell(cell, rowIndex, siteIndex)) continue;
+        int rank = rowRank[rowIndex];
+        int band = bandOf(rank);
+        if (bandOf(rank + rowSpan[cell] - 1) != band) continue;
+        bands[band].push_back(cell);
     }
 
-    // Check if swap is legal (no overlap)
-    if (isSwapLegal(cell1, cell2)) {
-        double oldDistance = displacement(cell1) + displacement(cell2);
-
-        // Swap positions
-        std::swap(cell1->x, cell2->x);
-        std::swap(cell1->y, cell2->y);
-
-        // Check for overlaps after swapping
-        if (!hasOverlapAfterSwap(cell1, cell2, cluster)) {
-            double newDistance = displacement(cell1) + displacement(cell2);
+    Utilities::parallelFor(bandCount, threadCount, [&](int band) {
+        std::seed_seq seedSequence{pass, static_cast<unsigned>(band), 1u};
+        std::default_random_engine generator(seedSequence);
+        annealCells(bands[band], generator, false, deadline);
+    });
+}
 
-            if (acceptMove(oldDistance, newDistance, temperature, probability(generator))) {
-                // Accept swap
+void Legalizer::annealCells(std::vector<int>& cellList, std::default_random_engine& generator,
+                            bool sameFootprint, std::chrono::steady_clock::time_point deadline) {
+    if (cellList.size() < 2) return;
+
+    std::uniform_real_distribution<double> probability(0.0, 1.0);
+
+    // The running cost is updated by each accepted swap's delta. Swaps
+    // accepted since the best solution was seen are logged so the best can be
+    // restored by undoing them, instead of copying every position on improvement.
+    // Only differences matter, so the wirelength term enters through the deltas.
+    double currentTotalDisplacement = calculateTotalDisplacement(cellList);
+    double bestTotalDisplacement = currentTotalDisplacement;
+    std::vector<SwapMove> undoLog;
+    SwapMove move;
+    long long movesSinceImprovement = 0;
+    long long movesMade = 0;
+    bool pastDeadline = std::chrono::steady_clock::now() >= deadline;
+
+    auto attempt = [&](double temperature) {
+        SwapResult result = attemptSwap(cellList, temperature, generator, probability, sameFootprint, move);
+        ++movesSinceImprovement;
+        // The clock is only read every few thousand moves
+        if (++movesMade % 4096 == 0 && std::chrono::steady_clock::now() >= deadline) pastDeadline = true;
+        if (result == SwapAccepted) {
+            currentTotalDisplacement += move.delta;
+            undoLog.push_back(move);
+            if (currentTotalDisplacement < bestTotalDisplacement) {
+                // Update best solution
+                bestTotalDisplacement = currentTotalDisplacement;
+                undoLog.clear();
+                movesSinceImprovement = 0;
+            }
+        }
+        return result;
+    };
+    // A run ends at the deadline of the whole annealing, or once it has stalled
+    auto stopped = [&]() { return pastDeadline || (stallMoves > 0 && movesSinceImprovement >= stallMoves); };
+
+    if (adaptiveCooling) {
+        // Modified Lam schedule: over a budget of moves proportional to the list
+        // size, the temperature is nudged every move so that the running
+        // acceptance ratio of legal moves follows a target that falls from 1 to
+        // 0.44 over the first 15% of the budget, holds there until 65%, and then
+        // decays towards zero
+        long long budget = std::max<long long>(1000, static_cast<long long>(lamMovesPerCell) * cellList.size());
+        double temperature = 1000.0;
+        double acceptanceRatio = 0.5;
+        for (long long moveIndex = 0; moveIndex < budget && !stopped(); ++moveIndex) {
+            SwapResult result = attempt(temperature);
+            if (result == SwapIllegal) continue;
+
+            double progress = static_cast<double>(moveIndex) / budget;
+            double target;
+            if (progress < 0.15) {
+                target = 0.44 + 0.56 * std::pow(560.0, -progress / 0.15);
+            } else if (progress < 0.65) {
+                target = 0.44;
             } else {
-                // Revert swap
-                std::swap(cell1->x, cell2->x);
-                std::swap(cell1->y, cell2->y);
+                target = 0.44 * std::pow(440.0, -(progress - 0.65) / 0.35);
+            }
+            acceptanceRatio = 0.998 * acceptanceRatio + (result == SwapAccepted ? 0.002 : 0.0);
+            if (acceptanceRatio > target) {
+                temperature *= 0.999;
+            } else {
+                temperature /= 0.999;
             }
-        } else {
-            // Revert swap due to overlap
-            std::swap(cell1->x, cell2->x);
-            std::swap(cell1->y, cell2->y);
+        }
+    } else {
+        double temperature = 1000.0;
+        double coolingRate = 0.99; // Adjusted cooling rate for better convergence
+        while (temperature > 1 && !stopped()) {
+            for (int iter = 0; iter < 1000 && !stopped(); ++iter) {
+                attempt(temperature);
+            }
+            temperature *= coolingRate;
         }
     }
+
+    // Restore best solution
+    undoSwaps(cellList, undoLog);
 }
 
-void Legalizer::attemptSwapGlobal(double temperature,
-                                  std::default_random_engine& generator,
-                                  std::uniform_real_distribution<double>& probability) {
-    std::uniform_int_distribution<int> cell_distribution(0, cells.size() - 1);
+Legalizer::SwapResult Legalizer::attemptSwap(std::vector<int>& cellList, double temperature,
+                            std::default_random_engine& generator,
+                            std::uniform_real_distribution<double>& probability,
+                            bool sameFootprint, SwapMove& move) {
+    std::uniform_int_distribution<int> cell_distribution(0, cellList.size() - 1);
 
     int idx1 = cell_distribution(generator);
     int idx2 = cell_distribution(generator);
-    if (idx1 == idx2) return;
+    if (idx1 == idx2) return SwapIllegal;
 
-    auto& cell1 = cells[idx1];
-    auto& cell2 = cells[idx2];
+    if (sameFootprint &&
+        std::ceil(cells.width[cellList[idx1]] / siteWidth) != std::ceil(cells.width[cellList[idx2]] / siteWidth)) {
+        return SwapIllegal;
+    }
 
-    // Only allow swapping cells if widths are equal
-    if (std::abs(cell1->width - cell2->width) > siteWidth * 0.1) {
-        return;
+    return trySwap(cellList, idx1, idx2, temperature, probability(generator), move);
+}
+
+Legalizer::SwapResult Legalizer::trySwap(std::vector<int>& cellList, int idx1, int idx2,
+                        double temperature, double randomValue, SwapMove& move) {
+    auto& cell1 = cellList[idx1];
+    auto& cell2 = cellList[idx2];
+
+    // Only allow swapping cells if widths and row spans are equal
+    if (std::abs(cells.width[cell1] - cells.width[cell2]) > siteWidth * 0.1 || rowSpan[cell1] != rowSpan[cell2]) {
+        return SwapIllegal;
+    }
+    if (!withinLimit(cell1, cells.x[cell2], cells.y[cell2]) || !withinLimit(cell2, cells.x[cell1], cells.y[cell1])) {
+        return SwapIllegal;
     }
 
-    // Check if swap is legal
-    if (isSwapLegal(cell1, cell2)) {
-        double oldDistance = displacement(cell1) + displacement(cell2);
+    // Check if swap is legal (no overlap)
+    if (!isSwapLegal(cell1, cell2)) return SwapIllegal;
 
-        // Swap positions
-        std::swap(cell1->x, cell2->x);
-        std::swap(cell1->y, cell2->y);
+    // Check for overlaps after swapping against the site occupancy of the target rows
+    if (hasOverlapAfterSwap(cell1, cell2)) return SwapIllegal;
 
-        // Check for overlaps after swapping
-        if (!hasOverlapAfterSwap(cell1, cell2, cells)) {
-            double newDistance = displacement(cell1) + displacement(cell2);
+    double oldDistance = displacement(cell1) + displacement(cell2);
+    double newDistance = std::abs(cells.x[cell2] - cells.originalX[cell1]) + std::abs(cells.y[cell2] - cells.originalY[cell1]) +
+                         std::abs(cells.x[cell1] - cells.originalX[cell2]) + std::abs(cells.y[cell1] - cells.originalY[cell2]);
+    if (wirelengthWeight > 0) {
+        CellMove moves[2] = {{cell1, cells.x[cell2], cells.y[cell2]}, {cell2, cells.x[cell1], cells.y[cell1]}};
+        newDistance += wirelengthWeight * wirelengthCache->delta(moves, 2);
+    }
 
-            if (acceptMove(oldDistance, newDistance, temperature, probability(generator))) {
-                // Accept swap
-            } else {
-                // Revert swap
-                std::swap(cell1->x, cell2->x);
-                std::swap(cell1->y, cell2->y);
+    if (!acceptMove(oldDistance, newDistance, temperature, randomValue)) return SwapRejected;
+
+    swapCells(cell1, cell2);
+    move.idx1 = idx1;
+    move.idx2 = idx2;
+    move.delta = newDistance - oldDistance;
+    return SwapAccepted;
+}
+
+void Legalizer::swapCells(int cell1, int cell2) {
+    // Exchange the positions of two placed cells and move their site occupancy along
+    int row1, site1, row2, site2;
+    bool placed1 = locateCell(cell1, row1, site1);
+    bool placed2 = locateCell(cell2, row2, site2);
+    int sites1 = static_cast<int>(std::ceil(cells.width[cell1] / siteWidth));
+    int sites2 = static_cast<int>(std::ceil(cells.width[cell2] / siteWidth));
+
+    if (wirelengthWeight > 0) {
+        CellMove moves[2] = {{cell1, cells.x[cell2], cells.y[cell2]}, {cell2, cells.x[cell1], cells.y[cell1]}};
+        wirelengthCache->apply(moves, 2);
+    }
+    std::swap(cells.x[cell1], cells.x[cell2]);
+    std::swap(cells.y[cell1], cells.y[cell2]);
+
+    // Swapped cells always cover the same number of rows
+    int span = rowSpan[cell1];
+    if (placed1 && placed2 && sites1 == sites2) {
+        // Same footprint: only the back-pointers change, the free segments stay as they are
+        for (int level = 0; level < span; ++level) {
+            auto& siteCells1 = rows[rowAbove(row1, level)]->siteCells;
+            auto& siteCells2 = rows[rowAbove(row2, level)]->siteCells;
+            for (int i = 0; i < sites1; ++i) {
+                siteCells1[site1 + i] = cell2;
+                siteCells2[site2 + i] = cell1;
             }
-        } else {
-            // Revert swap due to overlap
-            std::swap(cell1->x, cell2->x);
-            std::swap(cell1->y, cell2->y);
         }
+        return;
+    }
+
+    for (int level = 0; level < span; ++level) {
+        if (placed1) rows[rowAbove(row1, level)]->release(site1, sites1);
+        if (placed2) rows[rowAbove(row2, level)]->release(site2, sites2);
+    }
+    for (int level = 0; level < span; ++level) {
+        if (placed2) rows[rowAbove(row2, level)]->occupy(site2, sites1, cell1);
+        if (placed1) rows[rowAbove(row1, level)]->occupy(site1, sites2, cell2);
     }
 }
 
-bool Legalizer::hasOverlapAfterSwap(const std::shared_ptr<Cell>& cell1, const std::shared_ptr<Cell>& cell2,
-                                    const std::vector<std::shared_ptr<Cell>>& cellList) {
-    // Check for overlaps between swapped cells and other cells
-    for (const auto& otherCell : cellList) {
-        if (otherCell == cell1 || otherCell == cell2) continue;
-        if (cellsOverlap(cell1, otherCell) || cellsOverlap(cell2, otherCell)) {
-            return true;
-        }
+void Legalizer::undoSwaps(std::vector<int>& cellList, const std::vector<SwapMove>& undoLog) {
+    for (auto it = undoLog.rbegin(); it != undoLog.rend(); ++it) {
+        swapCells(cellList[it->idx1], cellList[it->idx2]);
     }
-    // Also check overlap between cell1 and cell2 (should not overlap since they swapped positions)
-    return false;
 }
 
+bool Legalizer::hasOverlapAfterSwap(int cell1, int cell2) {
+    // Only the sites each cell would cover at the other's position need checking:
+    // they must be inside the row and free or held by one of the two cells.
+    int row1, site1, row2, site2;
+    if (!locateCell(cell1, row1, site1) || !locateCell(cell2, row2, site2)) return true;
+    int sites1 = static_cast<int>(std::ceil(cells.width[cell1] / siteWidth));
+    int sites2 = static_cast<int>(std::ceil(cells.width[cell2] / siteWidth));
+
+    // After the swap cell1 covers [site2, site2 + sites1) of row2 and cell2 covers
+    // [site1, site1 + sites2) of row1, and the same sites of the rows above for
+    // multi-row cells; where their rows overlap those must stay disjoint
+    int span = rowSpan[cell1];
+    if (std::abs(rowRank[row1] - rowRank[row2]) < span && site2 < site1 + sites2 && site1 < site2 + sites1) return true;
+
+    auto blocked = [&](int rowIndex, int start, int count) {
+        for (int level = 0; level < span; ++level) {
+            const auto& row = rows[rowAbove(rowIndex, level)];
+            if (start + count > row->siteCount) return true;
+            for (int i = start; i < start + count; ++i) {
+                int owner = row->siteCells[i];
+                if (owner >= 0 && owner != cell1 && owner != cell2) return true;
+            }
+        }
+        return false;
+    };
+    return blocked(row2, site2, sites1) || blocked(row1, site1, sites2);
+}
 
-bool Legalizer::isSwapLegal(const std::shared_ptr<Cell>& cell1, const std::shared_ptr<Cell>& cell2) {
+bool Legalizer::isSwapLegal(int cell1, int cell2) {
     // Ensure cells will not overlap after swapping
     // Check if the target positions are available
     // For simplicity, assume positions are legal if they don't cause overlap
     return !cellsOverlap(cell1, cell2);
 }
 
-bool Legalizer::cellsOverlap(const std::shared_ptr<Cell>& cell1, const std::shared_ptr<Cell>& cell2) {
+bool Legalizer::cellsOverlap(int cell1, int cell2) {
     // Check if two cells overlap
-    double x1_min = cell1->x;
-    double x1_max = cell1->x + cell1->width;
-    double y1_min = cell1->y;
-    double y1_max = cell1->y + cell1->height;
+    double x1_min = cells.x[cell1];
+    double x1_max = cells.x[cell1] + cells.width[cell1];
+    double y1_min = cells.y[cell1];
+    double y1_max = cells.y[cell1] + cells.height[cell1];
 
-    double x2_min = cell2->x;
-    double x2_max = cell2->x + cell2->width;
-    double y2_min = cell2->y;
-    double y2_max = cell2->y + cell2->height;
+    double x2_min = cells.x[cell2];
+    double x2_max = cells.x[cell2] + cells.width[cell2];
+    double y2_min = cells.y[cell2];
+    double y2_max = cells.y[cell2] + cells.height[cell2];
 
     bool overlapX = x1_min < x2_max && x1_max > x2_min;
     bool overlapY = y1_min < y2_max && y1_max > y2_min;
@@ -462,8 +1522,8 @@ bool Legalizer::cellsOverlap(const std::shared_ptr<Cell>& cell1, const std::shar
     return overlapX && overlapY;
 }
 
-double Legalizer::displacement(const std::shared_ptr<Cell>& cell) {
-    return std::abs(cell->x - cell->originalX) + std::abs(cell->y - cell->originalY);
+double Legalizer::displacement(int cell) {
+    return std::abs(cells.x[cell] - cells.originalX[cell]) + std::abs(cells.y[cell] - cells.originalY[cell]);
 }
 
 bool Legalizer::acceptMove(double oldDistance, double newDistance, double temperature, double randomValue) {
@@ -478,22 +1538,26 @@ bool Legalizer::acceptMove(double oldDistance, double newDistance, double temper
 void Legalizer::calculateDisplacement() {
     totalDisplacement = 0;
     maxDisplacement = 0;
-    std::shared_ptr<Cell> maxDisplacementCell = nullptr;
+#ifdef DEBUG_LEGALIZER
+    int maxDisplacementCell = -1;
+#endif
 
-    for (auto& cell : cells) {
-        double displacement = std::abs(cell->x - cell->originalX) + std::abs(cell->y - cell->originalY);
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        double displacement = std::abs(cells.x[cell] - cells.originalX[cell]) + std::abs(cells.y[cell] - cells.originalY[cell]);
         totalDisplacement += displacement;
         if (displacement > maxDisplacement) {
             maxDisplacement = displacement;
+#ifdef DEBUG_LEGALIZER
             maxDisplacementCell = cell;
+#endif
         }
     }
 
 #ifdef DEBUG_LEGALIZER
-    if (maxDisplacementCell) {
-        std::cout << "Cell with maximum displacement: " << maxDisplacementCell->name << std::endl;
-        std::cout << "Original position: (" << maxDisplacementCell->originalX << ", " << maxDisplacementCell->originalY << ")" << std::endl;
-        std::cout << "Placed position: (" << maxDisplacementCell->x << ", " << maxDisplacementCell->y << ")" << std::endl;
+    if (maxDisplacementCell >= 0) {
+        std::cout << "Cell with maximum displacement: " << cells.name(maxDisplacementCell) << std::endl;
+        std::cout << "Original position: (" << cells.originalX[maxDisplacementCell] << ", " << cells.originalY[maxDisplacementCell] << ")" << std::endl;
+        std::cout << "Placed position: (" << cells.x[maxDisplacementCell] << ", " << cells.y[maxDisplacementCell] << ")" << std::endl;
         std::cout << "Displacement: " << maxDisplacement << std::endl;
     }
 #endif
@@ -509,7 +1573,7 @@ double Legalizer::getMaxDisplacement() const {
 }
 
 
-double Legalizer::calculateTotalDisplacement(const std::vector<std::shared_ptr<Cell>>& cellList) {
+double Legalizer::calculateTotalDisplacement(const std::vector<int>& cellList) {
     double totalDisplacement = 0.0;
     for (const auto& cell : cellList) {
         totalDisplacement += displacement(cell);
@@ -518,10 +1582,24 @@ double Legalizer::calculateTotalDisplacement(const std::vector<std::shared_ptr<C
 }
 
 void Legalizer::checkOverlap() {
-    for (size_t i = 0; i < cells.size(); ++i) {
-        for (size_t j = i + 1; j < cells.size(); ++j) {
-            if (cellsOverlap(cells[i], cells[j])) {
-                std::cerr << "Overlap detected between cells: " << cells[i]->name << " and " << cells[j]->name << std::endl;
+    // Sweep cells by left edge; only cells starting before the current one ends can overlap it
+    std::vector<int> order(cells.size());
+    for (int i = 0; i < cells.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return cells.x[a] < cells.x[b] || (cells.x[a] == cells.x[b] && a < b);
+    });
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        int cell = order[i];
+        for (size_t j = i + 1; j < order.size(); ++j) {
+            int otherCell = order[j];
+            if (cells.x[otherCell] >= cells.x[cell] + cells.width[cell]) break;
+            // Overlaps among fixed cells come with the design and are not reported
+            if (cells.isFixed[cell] && cells.isFixed[otherCell]) continue;
+            if (cellsOverlap(cell, otherCell)) {
+                std::cerr << "Overlap detected between cells: " << cells.name(cell) << " and " << cells.name(otherCell) << std::endl;
             }
         }
     }
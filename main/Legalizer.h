@@ -12,20 +12,36 @@
 #include <vector>
 #include <memory>
 #include <random>
+#include <functional>
+#include <limits>
+#include <chrono>
 
 // #define DEBUG_LEGALIZER
 
-class Cell;
+class CellStore;
+class NetStore;
+class NetBoxCache;
 class Row;
-class Site;
 
 class Legalizer {
 public:
-    Legalizer(std::vector<std::shared_ptr<Cell>>& cells, std::vector<std::shared_ptr<Row>>& rows, double siteWidth);
-    void computeDensity(double epsilon);
+    Legalizer(CellStore& cells, std::vector<std::shared_ptr<Row>>& rows, double siteWidth);
+    ~Legalizer();
+    void setThreadCount(int threads);
+    void setWirelengthWeight(const NetStore& nets, double weight);
+    void setMaxDisplacement(double limit);
+    void setAnnealingSchedule(bool adaptive, long long stallMoveCount, double minGain);
+    void computeDensity(double epsilon, bool bruteForce = false);
     void sortAndCluster();
     void placeCells();
+    void placeCellsAbacus();
+    void placeCellsTetris();
+    int placeCellsIncremental(const std::vector<double>& baselineX, const std::vector<double>& baselineY,
+                              const std::vector<char>& listed);
+    void refineAssignment();
+    void refineRows();
     void simulatedAnnealing(double maxDurationMinutes);
+    void parallelTempering(double maxDurationMinutes, int replicaCount);
     void calculateDisplacement();
     void checkOverlap();
 
@@ -33,25 +49,80 @@ public:
     double getMaxDisplacement() const;
 
 private:
-    void attemptSwap(std::vector<std::shared_ptr<Cell>>& cluster, double temperature,
-                     std::default_random_engine& generator,
-                     std::uniform_real_distribution<double>& probability);
-    void attemptSwapGlobal(double temperature,
+    void computeDensityBruteForce(double radius);
+    void computeDensityGrid(double radius);
+    void buildRowIndex();
+    void blockFixedCells();
+    int rowIndexAt(double y) const;
+    bool locateCell(int cell, int& rowIndex, int& siteIndex) const;
+    int rowAbove(int rowIndex, int level) const;
+    void forEachRowOutward(double y, const std::function<bool(int, double)>& visit);
+    bool findNearestFreeSite(int cell, int& bestRow, int& bestSite,
+                             double radius = std::numeric_limits<double>::max());
+    bool findNearestFreeSpan(int cell, int& bestRow, int& bestSite, double radius);
+    int firstCommonFreeRun(int rowIndex, int span, int from, int to, int sitesNeeded) const;
+    int lastCommonFreeRun(int rowIndex, int span, int upTo, int downTo, int sitesNeeded) const;
+    void placeAt(int cell, int rowIndex, int site);
+    void placeAtNearestSite(int cell);
+    bool shiftSegment(int rowIndex, int start, int end, const std::vector<int>& segmentCells);
+    bool placeWithinLimit(int cell);
+    bool withinLimit(int cell, double x, double y) const;
+    bool isFree(int rowIndex, int site, int cell) const;
+    // An accepted swap of two cells and the cost change it caused
+    struct SwapMove {
+        int idx1;
+        int idx2;
+        double delta;
+    };
+    // Outcome of a swap attempt; only legal moves count towards acceptance ratios
+    enum SwapResult { SwapIllegal, SwapRejected, SwapAccepted };
+
+    void restorePositions(const std::vector<std::pair<double, double>>& positions);
+    void printProgress(int elapsedSeconds, int totalSeconds, int& currentProgress);
+    void annealCluster(std::vector<int>& cluster, unsigned seed, std::chrono::steady_clock::time_point deadline);
+    void annealBands(unsigned pass, std::chrono::steady_clock::time_point deadline);
+    void annealCells(std::vector<int>& cellList, std::default_random_engine& generator,
+                     bool sameFootprint, std::chrono::steady_clock::time_point deadline);
+    SwapResult attemptSwap(std::vector<int>& cellList, double temperature,
                            std::default_random_engine& generator,
-                           std::uniform_real_distribution<double>& probability);
-    bool isSwapLegal(const std::shared_ptr<Cell>& cell1, const std::shared_ptr<Cell>& cell2);
-    bool cellsOverlap(const std::shared_ptr<Cell>& cell1, const std::shared_ptr<Cell>& cell2);
-    bool hasOverlapAfterSwap(const std::shared_ptr<Cell>& cell1, const std::shared_ptr<Cell>& cell2,
-                                        const std::vector<std::shared_ptr<Cell>>& cellList);
-    double displacement(const std::shared_ptr<Cell>& cell);
+                           std::uniform_real_distribution<double>& probability,
+                           bool sameFootprint, SwapMove& move);
+    SwapResult trySwap(std::vector<int>& cellList, int idx1, int idx2,
+                       double temperature, double randomValue, SwapMove& move);
+    void swapCells(int cell1, int cell2);
+    void undoSwaps(std::vector<int>& cellList, const std::vector<SwapMove>& undoLog);
+    bool isSwapLegal(int cell1, int cell2);
+    bool cellsOverlap(int cell1, int cell2);
+    bool hasOverlapAfterSwap(int cell1, int cell2);
+    double displacement(int cell);
     bool acceptMove(double oldDistance, double newDistance, double temperature, double randomValue);
-    double calculateTotalDisplacement(const std::vector<std::shared_ptr<Cell>>& cellList);
+    double calculateTotalDisplacement(const std::vector<int>& cellList);
 
-    std::vector<std::shared_ptr<Cell>>& cells;
+    CellStore& cells;
+    std::vector<int> allCells; // Every movable cell id, for global moves
     std::vector<std::shared_ptr<Row>>& rows;
     double siteWidth;
+    int threadCount;
+    unsigned passCount;
+
+    std::vector<std::vector<int>> clusters;
+    std::vector<int> rowsByY; // Row indices sorted by originY
+    std::vector<int> rowRank; // Position of each row in rowsByY
+    std::vector<int> spanLimit; // Per row: rows stacked from it on the same site grid, itself included
+    std::vector<int> rowSpan; // Number of rows each cell covers
+
+    // Optional cap on the displacement of any cell, 0 if unlimited
+    double displacementLimit;
+
+    // Annealing schedule and stop criteria
+    static const int lamMovesPerCell = 100;
+    bool adaptiveCooling;
+    long long stallMoves;
+    double minRelativeGain;
 
-    std::vector<std::vector<std::shared_ptr<Cell>>> clusters;
+    // Optional wirelength term of the annealing cost: weight * weighted HPWL
+    double wirelengthWeight;
+    std::unique_ptr<NetBoxCache> wirelengthCache;
 
     double totalDisplacement;
     double maxDisplacement;
@@ -0,0 +1,164 @@
+///////////////////////////
+// File: NetBoxCache.cpp //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#include "NetBoxCache.h"
+#include "CellStore.h"
+#include "NetStore.h"
+#include <limits>
+
+namespace {
+
+// Adding and removing a coordinate on a box side that keeps the count of
+// pins lying on it; Low sides are minima, High sides maxima
+void addLow(double& bound, int& count, double value) {
+    if (value < bound) {
+        bound = value;
+        count = 1;
+    } else if (value == bound) {
+        ++count;
+    }
+}
+
+void addHigh(double& bound, int& count, double value) {
+    if (value > bound) {
+        bound = value;
+        count = 1;
+    } else if (value == bound) {
+        ++count;
+    }
+}
+
+void remove(double bound, int& count, double value) {
+    if (value == bound) --count;
+}
+
+} // namespace
+
+NetBoxCache::NetBoxCache(const NetStore& nets, const CellStore& cells)
+    : nets(nets), cells(cells), totalWirelength(0), visitStamp(0) {
+    build();
+}
+
+void NetBoxCache::build() {
+    boxes.resize(nets.size());
+    totalWirelength = 0;
+    for (int net = 0; net < nets.size(); ++net) {
+        boxes[net] = scan(net, nullptr, 0);
+        totalWirelength += wirelength(net, boxes[net]);
+    }
+    netVisit.assign(nets.size(), 0);
+    visitStamp = 0;
+}
+
+double NetBoxCache::total() const {
+    return totalWirelength;
+}
+
+double NetBoxCache::delta(const CellMove* moves, int moveCount) {
+    // Weighted HPWL change if the cells were moved, without changing anything
+    return update(moves, moveCount, false);
+}
+
+void NetBoxCache::apply(const CellMove* moves, int moveCount) {
+    // Records the moves; call before the positions in the CellStore change
+    totalWirelength += update(moves, moveCount, true);
+}
+
+double NetBoxCache::pinX(int pin, const CellMove* moves, int moveCount) const {
+    // Pin position after moves; Bookshelf pin offsets are relative to the cell center
+    int cell = nets.pinCell[pin];
+    double x = cells.x[cell];
+    for (int i = 0; i < moveCount; ++i) {
+        if (moves[i].cell == cell) x = moves[i].x;
+    }
+    return x + cells.width[cell] / 2 + nets.pinOffsetX[pin];
+}
+
+double NetBoxCache::pinY(int pin, const CellMove* moves, int moveCount) const {
+    int cell = nets.pinCell[pin];
+    double y = cells.y[cell];
+    for (int i = 0; i < moveCount; ++i) {
+        if (moves[i].cell == cell) y = moves[i].y;
+    }
+    return y + cells.height[cell] / 2 + nets.pinOffsetY[pin];
+}
+
+NetBoxCache::Box NetBoxCache::scan(int net, const CellMove* moves, int moveCount) const {
+    double low = std::numeric_limits<double>::max();
+    double high = std::numeric_limits<double>::lowest();
+    Box box = {low, high, low, high, 0, 0, 0, 0};
+    for (int pin = nets.netPinStart[net]; pin < nets.netPinStart[net + 1]; ++pin) {
+        double x = pinX(pin, moves, moveCount);
+        double y = pinY(pin, moves, moveCount);
+        addLow(box.minX, box.minXCount, x);
+        addHigh(box.maxX, box.maxXCount, x);
+        addLow(box.minY, box.minYCount, y);
+        addHigh(box.maxY, box.maxYCount, y);
+    }
+    return box;
+}
+
+NetBoxCache::Box NetBoxCache::moved(int net, const CellMove* moves, int moveCount) const {
+    // Takes every moved pin of the net off the box, then puts it back at its new
+    // position. Only a side left without pins needs a rescan of the net.
+    Box box = boxes[net];
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < moveCount; ++i) {
+            int cell = moves[i].cell;
+            for (int k = nets.cellPinStart[cell]; k < nets.cellPinStart[cell + 1]; ++k) {
+                int pin = nets.cellPins[k];
+                if (nets.pinNet[pin] != net) continue;
+                if (pass == 0) {
+                    double x = pinX(pin, nullptr, 0);
+                    double y = pinY(pin, nullptr, 0);
+                    remove(box.minX, box.minXCount, x);
+                    remove(box.maxX, box.maxXCount, x);
+                    remove(box.minY, box.minYCount, y);
+                    remove(box.maxY, box.maxYCount, y);
+                } else {
+                    double x = pinX(pin, moves, moveCount);
+                    double y = pinY(pin, moves, moveCount);
+                    addLow(box.minX, box.minXCount, x);
+                    addHigh(box.maxX, box.maxXCount, x);
+                    addLow(box.minY, box.minYCount, y);
+                    addHigh(box.maxY, box.maxYCount, y);
+                }
+            }
+        }
+    }
+    if (box.minXCount == 0 || box.maxXCount == 0 || box.minYCount == 0 || box.maxYCount == 0) {
+        return scan(net, moves, moveCount);
+    }
+    return box;
+}
+
+double NetBoxCache::wirelength(int net, const Box& box) const {
+    if (box.minXCount == 0) return 0; // No pins
+    return nets.weight[net] * ((box.maxX - box.minX) + (box.maxY - box.minY));
+}
+
+double NetBoxCache::update(const CellMove* moves, int moveCount, bool commit) {
+    double change = 0;
+    if (++visitStamp == 0) {
+        netVisit.assign(nets.size(), 0);
+        visitStamp = 1;
+    }
+    for (int i = 0; i < moveCount; ++i) {
+        int cell = moves[i].cell;
+        for (int k = nets.cellPinStart[cell]; k < nets.cellPinStart[cell + 1]; ++k) {
+            int net = nets.pinNet[nets.cellPins[k]];
+            if (netVisit[net] == visitStamp) continue;
+            netVisit[net] = visitStamp;
+
+            Box box = moved(net, moves, moveCount);
+            change += wirelength(net, box) - wirelength(net, boxes[net]);
+            if (commit) boxes[net] = box;
+        }
+    }
+    return change;
+}
@@ -0,0 +1,63 @@
+///////////////////////////
+// File: NetBoxCache.h   //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#ifndef NETBOXCACHE_H
+#define NETBOXCACHE_H
+
+#include <vector>
+
+class CellStore;
+class NetStore;
+
+// A cell moving from its current position in the CellStore to (x, y)
+struct CellMove {
+    int cell;
+    double x;
+    double y;
+};
+
+// Bounding boxes of every net's pins with the number of pins on each side,
+// giving the weighted half-perimeter wirelength (HPWL). Moving cells only
+// touches their nets, and a box is rescanned only when the last pin on one of
+// its sides moves inward, so updates are amortized O(1) per moved pin.
+class NetBoxCache {
+public:
+    NetBoxCache(const NetStore& nets, const CellStore& cells);
+    void build();
+    double total() const;
+    double delta(const CellMove* moves, int moveCount);
+    void apply(const CellMove* moves, int moveCount);
+
+private:
+    struct Box {
+        double minX;
+        double maxX;
+        double minY;
+        double maxY;
+        int minXCount;
+        int maxXCount;
+        int minYCount;
+        int maxYCount;
+    };
+
+    double pinX(int pin, const CellMove* moves, int moveCount) const;
+    double pinY(int pin, const CellMove* moves, int moveCount) const;
+    Box scan(int net, const CellMove* moves, int moveCount) const;
+    Box moved(int net, const CellMove* moves, int moveCount) const;
+    double wirelength(int net, const Box& box) const;
+    double update(const CellMove* moves, int moveCount, bool commit);
+
+    const NetStore& nets;
+    const CellStore& cells;
+    std::vector<Box> boxes;
+    double totalWirelength;
+    std::vector<unsigned> netVisit; // Stamp of the last update that saw each net
+    unsigned visitStamp;
+};
+
+#endif // NETBOXCACHE_H
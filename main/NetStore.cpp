@@ -0,0 +1,51 @@
+///////////////////////////
+// File: NetStore.cpp    //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#include "NetStore.h"
+
+NetStore::NetStore() : netPinStart(1, 0) {}
+
+int NetStore::addNet(double weight) {
+    int id = size();
+    this->weight.push_back(weight);
+    netPinStart.push_back(pinCount());
+    return id;
+}
+
+void NetStore::addPin(int cell, double offsetX, double offsetY) {
+    // Pins always belong to the most recently added net
+    pinCell.push_back(cell);
+    pinNet.push_back(size() - 1);
+    pinOffsetX.push_back(offsetX);
+    pinOffsetY.push_back(offsetY);
+    netPinStart.back() = pinCount();
+}
+
+void NetStore::buildCellIndex(int cellCount) {
+    // Counting sort of the pins by cell
+    cellPinStart.assign(cellCount + 1, 0);
+    for (int cell : pinCell) {
+        ++cellPinStart[cell + 1];
+    }
+    for (int cell = 0; cell < cellCount; ++cell) {
+        cellPinStart[cell + 1] += cellPinStart[cell];
+    }
+    cellPins.resize(pinCell.size());
+    std::vector<int> next(cellPinStart.begin(), cellPinStart.end() - 1);
+    for (int pin = 0; pin < pinCount(); ++pin) {
+        cellPins[next[pinCell[pin]]++] = pin;
+    }
+}
+
+int NetStore::size() const {
+    return static_cast<int>(weight.size());
+}
+
+int NetStore::pinCount() const {
+    return static_cast<int>(pinCell.size());
+}
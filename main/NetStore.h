@@ -0,0 +1,40 @@
+///////////////////////////
+// File: NetStore.h      //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#ifndef NETSTORE_H
+#define NETSTORE_H
+
+#include <vector>
+
+// Nets in compressed sparse row form. The pins of net n are the indices
+// [netPinStart[n], netPinStart[n + 1]) of the pin arrays; after
+// buildCellIndex the pins on cell c are cellPins[cellPinStart[c] ..
+// cellPinStart[c + 1]).
+class NetStore {
+public:
+    NetStore();
+    int addNet(double weight = 1.0);
+    void addPin(int cell, double offsetX, double offsetY);
+    void buildCellIndex(int cellCount);
+    int size() const;
+    int pinCount() const;
+
+    std::vector<int> netPinStart;
+    std::vector<double> weight;
+
+    // Per pin: owning cell and net, and offset from the cell center
+    std::vector<int> pinCell;
+    std::vector<int> pinNet;
+    std::vector<double> pinOffsetX;
+    std::vector<double> pinOffsetY;
+
+    std::vector<int> cellPinStart;
+    std::vector<int> cellPins;
+};
+
+#endif // NETSTORE_H
@@ -7,47 +7,157 @@
 ///////////////////////////
 
 #include "Parser.h"
-#include "Cell.h"
 #include "Row.h"
-#include "Site.h"
-#include <fstream>
-#include <sstream>
-#include <iostream>
+#include "Tokenizer.h"
+#include "Utilities.h"
 #include <algorithm>
-#include <regex>
+#include <iostream>
+#include <thread>
 
 Parser::Parser(const std::string& inputPath, const std::string& filePrefix)
-    : siteWidth(1.0), siteHeight(1.0), inputPath(inputPath), filePrefix(filePrefix) {
+    : siteWidth(1.0), siteHeight(1.0), threadCount(1), inputPath(inputPath), filePrefix(filePrefix) {
     nodesFile = filePrefix + ".nodes";
     plFile = filePrefix + ".pl";
     sclFile = filePrefix + ".scl";
+    netsFile = filePrefix + ".nets";
+    wtsFile = filePrefix + ".wts";
     // Initialize other file names if necessary
 }
 
+void Parser::setThreadCount(int threads) {
+    threadCount = std::max(threads, 1);
+}
+
 void Parser::parse() {
     parseAux();
-    parseNodes();
-    parsePl();
-    parseScl();
+    if (threadCount > 1) {
+        // Rows do not depend on the cells, so the .scl file is read alongside;
+        // nets only look cell names up, so they are read alongside the .pl
+        std::thread sclThread(&Parser::parseScl, this);
+        parseNodes();
+        std::thread netsThread(&Parser::parseNets, this);
+        parsePl();
+        netsThread.join();
+        sclThread.join();
+    } else {
+        parseNodes();
+        parsePl();
+        parseScl();
+        parseNets();
+    }
+    parseWts();
+}
+
+namespace {
+
+// Records parsed from one newline-aligned chunk of a file, plus the text of
+// malformed lines so they can be reported in file order
+template <typename Record>
+struct ChunkResult {
+    std::vector<Record> records;
+    std::vector<std::string> errors;
+};
+
+// Runs parseLine(tokens, records) over every line of file, splitting the file
+// into chunks parsed on up to threadCount threads. parseLine appends what it
+// reads to records and returns false for a malformed line.
+template <typename Record, typename ParseLine>
+std::vector<ChunkResult<Record>> parseChunks(const MappedFile& file, int threadCount, const ParseLine& parseLine) {
+    int chunkCount = threadCount > 1 ? threadCount * 4 : 1;
+    std::vector<size_t> bounds = file.splitLines(chunkCount);
+    std::vector<ChunkResult<Record>> results(chunkCount);
+    Utilities::parallelFor(chunkCount, threadCount, [&](int chunk) {
+        Tokenizer tokens(file.data() + bounds[chunk], file.data() + bounds[chunk + 1]);
+        auto& result = results[chunk];
+        while (tokens.nextLine()) {
+            if (!parseLine(tokens, result.records)) {
+                result.errors.push_back(tokens.line());
+            }
+        }
+    });
+    return results;
+}
+
+struct NodeRecord {
+    Token name;
+    double width;
+    double height;
+    bool terminal;
+};
+
+struct PlRecord {
+    int cell;
+    double x;
+    double y;
+    Token orientation;
+    bool fixed;
+};
+
+// Either a NetDegree line starting a net or a pin of the net started last;
+// a net's pins may continue into the next chunk
+struct NetRecord {
+    bool startsNet;
+    Token name;
+    int cell;
+    double offsetX;
+    double offsetY;
+};
+
+struct WeightRecord {
+    Token name;
+    double weight;
+};
+
+// Name lookups only read the cell store, so they are done by the workers
+std::vector<ChunkResult<PlRecord>> parsePlChunks(const MappedFile& file, int threadCount, const CellStore& cells) {
+    return parseChunks<PlRecord>(file, threadCount, [&cells](Tokenizer& tokens, std::vector<PlRecord>& records) {
+        PlRecord record;
+        Token name, x, y;
+        tokens.next(name);
+        if (name == "UCLA") return true;
+
+        if (!tokens.next(x) || !x.toDouble(record.x) || !tokens.next(y) || !y.toDouble(record.y)) {
+            return false;
+        }
+        record.cell = cells.find(name.str());
+        if (record.cell < 0) return true;
+        // Optional orientation, then an optional /FIXED or /FIXED_NI marker
+        Token marker = {nullptr, 0};
+        if (!tokens.next(record.orientation)) {
+            record.orientation.length = 0;
+        } else if (record.orientation.data[0] == '/') {
+            marker = record.orientation;
+            record.orientation.length = 0;
+        } else {
+            tokens.next(marker);
+        }
+        record.fixed = marker == "/FIXED" || marker == "/FIXED_NI";
+        records.push_back(record);
+        return true;
+    });
 }
 
+} // namespace
+
 void Parser::parseAux() {
-    std::ifstream file(inputPath + filePrefix + ".aux");
-    if (!file.is_open()) {
+    MappedFile file(inputPath + filePrefix + ".aux");
+    if (!file.isOpen()) {
         std::cerr << "Failed to open " << filePrefix << ".aux file." << std::endl;
         // Proceed with default filenames
         return;
     }
 
-    std::string line;
-    if (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string keyword;
-        iss >> keyword; // Skip the first keyword
-        std::string filename;
-        while (iss >> filename) {
+    Tokenizer tokens(file);
+    Token token;
+    if (tokens.nextLine() && tokens.next(token)) { // Skip the first keyword
+        while (tokens.next(token)) {
+            std::string filename = token.str();
             if (filename.find(".nodes") != std::string::npos) {
                 nodesFile = filename;
+            } else if (filename.find(".nets") != std::string::npos) {
+                netsFile = filename;
+            } else if (filename.find(".wts") != std::string::npos) {
+                wtsFile = filename;
             } else if (filename.find(".pl") != std::string::npos) {
                 plFile = filename;
             } else if (filename.find(".scl") != std::string::npos) {
@@ -56,153 +166,159 @@ void Parser::parseAux() {
             // Add handling for other file types if necessary
         }
     }
-    file.close();
 }
 
 void Parser::parseNodes() {
-    std::ifstream file(inputPath + nodesFile);
-    if (!file.is_open()) {
+    MappedFile file(inputPath + nodesFile);
+    if (!file.isOpen()) {
         std::cerr << "Failed to open " << nodesFile << std::endl;
         return;
     }
 
-    std::string line;
-    while (std::getline(file, line)) {
+    auto chunks = parseChunks<NodeRecord>(file, threadCount, [](Tokenizer& tokens, std::vector<NodeRecord>& records) {
+        NodeRecord record;
+        Token width, height, type;
+        tokens.next(record.name);
         // Skip the header lines
-        if (line.find("UCLA nodes 1.0") != std::string::npos ||
-            line.find("NumNodes") != std::string::npos ||
-            line.find("NumTerminals") != std::string::npos) {
-            continue;
-        }
+        if (record.name == "UCLA" || record.name == "NumNodes" || record.name == "NumTerminals") return true;
 
-        if (line.empty() || line[0] == '#') continue;
+        if (!tokens.next(width) || !width.toDouble(record.width) || !tokens.next(height) || !height.toDouble(record.height)) {
+            return false;
+        }
+        // Terminals (including non-image terminal_NI) never move
+        record.terminal = tokens.next(type) && (type == "terminal" || type == "terminal_NI");
+        records.push_back(record);
+        return true;
+    });
 
-        std::istringstream iss(line);
-        std::string name;
-        double width, height;
-        iss >> name >> width >> height;
-        auto cell = std::make_shared<Cell>(name, width, height);
-        cells.push_back(cell);
+    // Cells are numbered in file order
+    for (const auto& chunk : chunks) {
+        for (const auto& error : chunk.errors) {
+            std::cerr << "Error parsing line: " << error << std::endl;
+        }
+        for (const auto& record : chunk.records) {
+            int cell = cells.addCell(record.name.str(), record.width, record.height);
+            if (record.terminal) cells.isFixed[cell] |= CellStore::FixedTerminal;
+        }
     }
-    file.close();
 }
 
 void Parser::parsePl() {
-    std::ifstream file(inputPath + plFile);
-    if (!file.is_open()) {
+    MappedFile file(inputPath + plFile);
+    if (!file.isOpen()) {
         std::cerr << "Failed to open " << plFile << std::endl;
         return;
     }
 
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#' || line.find("UCLA") == 0) continue;
-
-        // Remove ':' from the line
-        line.erase(std::remove(line.begin(), line.end(), ':'), line.end());
-        
-        std::istringstream iss(line);
-        std::string name;
-        double x, y;
-        std::string orientation;
-        iss >> name >> x >> y >> orientation;
-        for (auto& cell : cells) {
-            if (cell->name == name) {
-                cell->x = x;
-                cell->y = y;
-                cell->originalX = x;
-                cell->originalY = y;
-                cell->orientation = orientation;
-                break;
+    auto chunks = parsePlChunks(file, threadCount, cells);
+
+    // Apply in file order so a cell listed twice keeps its last position
+    for (const auto& chunk : chunks) {
+        for (const auto& error : chunk.errors) {
+            std::cerr << "Error parsing line: " << error << std::endl;
+        }
+        for (const auto& record : chunk.records) {
+            int cell = record.cell;
+            cells.x[cell] = record.x;
+            cells.y[cell] = record.y;
+            cells.originalX[cell] = record.x;
+            cells.originalY[cell] = record.y;
+            if (record.orientation.length > 0) {
+                cells.setOrientation(cell, record.orientation.str());
+            }
+            if (record.fixed) {
+                cells.isFixed[cell] |= CellStore::FixedPlacement;
             }
         }
     }
-    file.close();
 #ifdef DEBUG_PARSER
     std::cout << "Parsed " << cells.size() << " cells." << std::endl;
-    for (const auto& cell : cells) {
-        std::cout << cell->name << " " << cell->width << " " << cell->height << " " << cell->x << " " << cell->y
-                  << " " << cell->isFixed << " " << cell->orientation << std::endl;
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        std::cout << cells.name(cell) << " " << cells.width[cell] << " " << cells.height[cell] << " " << cells.x[cell] << " "
+                  << cells.y[cell] << " " << static_cast<bool>(cells.isFixed[cell]) << " " << cells.orientation(cell) << std::endl;
     }
 #endif
 }
 
+bool Parser::parsePlacement(const std::string& path, std::vector<double>& x, std::vector<double>& y,
+                            std::vector<char>& listed) {
+    // Reads another .pl for the parsed cells, such as the result of an earlier
+    // run, without touching the cell store
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    auto chunks = parsePlChunks(file, threadCount, cells);
+    x.assign(cells.size(), 0);
+    y.assign(cells.size(), 0);
+    listed.assign(cells.size(), 0);
+    for (const auto& chunk : chunks) {
+        for (const auto& error : chunk.errors) {
+            std::cerr << "Error parsing line: " << error << std::endl;
+        }
+        for (const auto& record : chunk.records) {
+            x[record.cell] = record.x;
+            y[record.cell] = record.y;
+            listed[record.cell] = 1;
+        }
+    }
+    return true;
+}
+
 void Parser::parseScl() {
-    std::ifstream file(inputPath + sclFile);
-    if (!file.is_open()) {
+    MappedFile file(inputPath + sclFile);
+    if (!file.isOpen()) {
         std::cerr << "Failed to open " << sclFile << std::endl;
         return;
     }
 
-    std::string line;
-    bool inCoreRow = false;
+    Tokenizer tokens(file);
     std::shared_ptr<Row> currentRow = nullptr;
-    while (std::getline(file, line)) {
-        // Trim leading and trailing whitespace from the line
-        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](unsigned char ch) { return !std::isspace(ch); }));
-        line.erase(std::find_if(line.rbegin(), line.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), line.end());
-        
-        if (line.find("CoreRow") != std::string::npos) {
-            inCoreRow = true;
+    Token keyword, value, sitesKeyword, sites;
+    while (tokens.nextLine()) {
+        tokens.next(keyword);
+        if (keyword == "CoreRow") {
             currentRow = std::make_shared<Row>(0, 0, siteWidth, 0);
             continue;
         }
-        if (inCoreRow) {
-            if (line.find("End") != std::string::npos) {
-                rows.push_back(currentRow);
-                inCoreRow = false;
+        if (!currentRow) continue;
+        if (keyword == "End") {
+            rows.push_back(currentRow);
+            currentRow = nullptr;
+            continue;
+        }
+
+        if (keyword != "Coordinate" && keyword != "Height" && keyword != "Sitewidth" && keyword != "SubrowOrigin") continue;
+        double number;
+        if (!tokens.next(value) || !value.toDouble(number)) {
+            std::cerr << "Error parsing line: " << tokens.line() << "\nReason: Invalid number." << std::endl;
+            continue;
+        }
+
+        if (keyword == "Coordinate") {
+            currentRow->originY = number;
+        } else if (keyword == "Height") {
+            currentRow->height = number;
+            siteHeight = currentRow->height;
+        } else if (keyword == "Sitewidth") {
+            currentRow->siteWidth = number;
+            siteWidth = currentRow->siteWidth;
+        } else {
+            // SubrowOrigin : x NumSites : count (the keyword is also spelled Numsites)
+            int siteCount;
+            if (!tokens.next(sitesKeyword) || (sitesKeyword != "NumSites" && sitesKeyword != "Numsites") ||
+                !tokens.next(sites) || !sites.toInt(siteCount)) {
+                std::cerr << "Error parsing line: " << tokens.line() << "\nReason: Invalid format for SubrowOrigin line." << std::endl;
                 continue;
             }
-            size_t colonPos = line.find(":");
-            if (colonPos != std::string::npos) {
-                std::string keyword = line.substr(0, colonPos);
-                std::string valueStr = line.substr(colonPos + 1);
-                keyword.erase(std::remove_if(keyword.begin(), keyword.end(), ::isspace), keyword.end());
-                valueStr.erase(std::remove_if(valueStr.begin(), valueStr.end(), ::isspace), valueStr.end());
-
-                try {
-                    if (keyword == "Coordinate") {
-                        currentRow->originY = std::stod(valueStr);
-                    } else if (keyword == "Height") {
-                        currentRow->height = std::stod(valueStr);
-                        siteHeight = currentRow->height;
-                    } else if (keyword == "Sitewidth") {
-                        currentRow->siteWidth = std::stod(valueStr);
-                        siteWidth = currentRow->siteWidth;
-                    } else if (keyword == "SubrowOrigin") {
-                        double x = 0;
-                        int siteCount = 0;
-
-                        // Use regex to extract SubrowOrigin and NumSites (case-insensitive)
-                        std::regex re("\\s*SubrowOrigin\\s*:\\s*(-?\\d+)\\s*Num[Ss]ites\\s*:\\s*(-?\\d+)");
-                        std::smatch match;
-                        if (std::regex_search(line, match, re)) {
-                            if (match.size() == 3) { // match[0] is the full match, match[1] is x, match[2] is siteCount
-                                x = std::stod(match[1].str());
-                                siteCount = std::stoi(match[2].str());
-                            } else {
-                                throw std::invalid_argument("Failed to extract SubrowOrigin and NumSites.");
-                            }
-                        } else {
-                            throw std::invalid_argument("Invalid format for SubrowOrigin line.");
-                        }
-
-                        currentRow->originX = x;
-                        currentRow->siteCount = siteCount;
-                        // Initialize sites in the row
-                        currentRow->sites.clear();
-                        for (int i = 0; i < siteCount; ++i) {
-                            currentRow->sites.push_back(std::make_shared<Site>(x + i * siteWidth, currentRow->originY));
-                        }
-                    }
-                } catch (const std::invalid_argument& e) {
-                    std::cerr << "Error parsing line: " << line << "\nReason: " << e.what() << std::endl;
-                    continue;
-                }
-            }
+            currentRow->originX = number;
+            currentRow->siteCount = siteCount;
+            // Initialize sites in the row
+            currentRow->buildSites();
         }
     }
-    file.close();
 #ifdef DEBUG_PARSER
     std::cout << "Parsed " << rows.size() << " rows." << std::endl;
     for (const auto& row : rows) {
@@ -211,3 +327,86 @@ void Parser::parseScl() {
     }
 #endif
 }
+
+void Parser::parseNets() {
+    MappedFile file(inputPath + netsFile);
+    if (!file.isOpen()) {
+        std::cerr << "Failed to open " << netsFile << std::endl;
+        return;
+    }
+
+    auto chunks = parseChunks<NetRecord>(file, threadCount, [this](Tokenizer& tokens, std::vector<NetRecord>& records) {
+        NetRecord record = {false, {nullptr, 0}, -1, 0.0, 0.0};
+        Token first, token;
+        tokens.next(first);
+        if (first == "UCLA" || first == "NumNets" || first == "NumPins") return true;
+
+        if (first == "NetDegree") {
+            // NetDegree : count [name]
+            record.startsNet = true;
+            tokens.next(token);
+            tokens.next(record.name);
+            records.push_back(record);
+            return true;
+        }
+
+        // name direction : offsetX offsetY, where the direction and offsets are optional
+        record.cell = cells.find(first.str());
+        if (record.cell < 0) return false;
+        if (tokens.next(token) && !token.toDouble(record.offsetX)) {
+            if (tokens.next(token) && !token.toDouble(record.offsetX)) return false;
+        }
+        if (tokens.next(token) && !token.toDouble(record.offsetY)) return false;
+        records.push_back(record);
+        return true;
+    });
+
+    for (const auto& chunk : chunks) {
+        for (const auto& error : chunk.errors) {
+            std::cerr << "Error parsing line: " << error << std::endl;
+        }
+        for (const auto& record : chunk.records) {
+            if (record.startsNet) {
+                int net = nets.addNet();
+                if (record.name.length > 0) netIndex.emplace(record.name.str(), net);
+            } else if (nets.size() > 0) {
+                nets.addPin(record.cell, record.offsetX, record.offsetY);
+            }
+        }
+    }
+    nets.buildCellIndex(cells.size());
+}
+
+void Parser::parseWts() {
+    // Only named nets can be weighted; the .wts files of designs with unnamed
+    // nets list node weights, which the legalizer has no use for
+    if (netIndex.empty()) return;
+
+    MappedFile file(inputPath + wtsFile);
+    if (!file.isOpen()) {
+        std::cerr << "Failed to open " << wtsFile << std::endl;
+        return;
+    }
+
+    auto chunks = parseChunks<WeightRecord>(file, threadCount, [](Tokenizer& tokens, std::vector<WeightRecord>& records) {
+        WeightRecord record;
+        Token weight;
+        tokens.next(record.name);
+        if (record.name == "UCLA") return true;
+        if (!tokens.next(weight) || !weight.toDouble(record.weight)) return false;
+        records.push_back(record);
+        return true;
+    });
+
+    for (const auto& chunk : chunks) {
+        for (const auto& error : chunk.errors) {
+            std::cerr << "Error parsing line: " << error << std::endl;
+        }
+        for (const auto& record : chunk.records) {
+            auto it = netIndex.find(record.name.str());
+            if (it != netIndex.end()) {
+                nets.weight[it->second] = record.weight;
+            }
+        }
+    }
+}
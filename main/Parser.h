@@ -12,34 +12,48 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include "CellStore.h"
+#include "NetStore.h"
 
 // #define DEBUG_PARSER
 
-class Cell;
 class Row;
 
 class Parser {
 public:
     Parser(const std::string& inputPath, const std::string& filePrefix);
+    void setThreadCount(int threads);
     void parse();
+    bool parsePlacement(const std::string& path, std::vector<double>& x, std::vector<double>& y,
+                        std::vector<char>& listed);
 
-    std::vector<std::shared_ptr<Cell>> cells;
+    CellStore cells;
+    NetStore nets;
     std::vector<std::shared_ptr<Row>> rows;
     double siteWidth;
     double siteHeight;
 
 private:
+    int threadCount;
     std::string inputPath;
     std::string filePrefix;
     void parseAux();
     void parseNodes();
     void parsePl();
     void parseScl();
+    void parseNets();
+    void parseWts();
 
     // Filenames
     std::string nodesFile;
     std::string plFile;
     std::string sclFile;
+    std::string netsFile;
+    std::string wtsFile;
+
+    // Named nets, for resolving .wts entries
+    std::unordered_map<std::string, int> netIndex;
     // Add other file types if necessary
 };
 
@@ -7,12 +7,198 @@
 ///////////////////////////
 
 #include "Row.h"
-#include "Site.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int WordBits = 64;
+
+// Mask of bits [bit, 64) and [0, bit] of a word
+uint64_t bitsFrom(int bit) {
+    return ~0ULL << bit;
+}
+
+uint64_t bitsThrough(int bit) {
+    return bit == WordBits - 1 ? ~0ULL : (1ULL << (bit + 1)) - 1;
+}
+
+} // namespace
 
 Row::Row(double originX, double originY, double siteWidth, int siteCount)
     : originX(originX), originY(originY), height(0), siteWidth(siteWidth), siteCount(siteCount) {
-    // Initialize sites
-    for (int i = 0; i < siteCount; ++i) {
-        sites.push_back(std::make_shared<Site>(originX + i * siteWidth, originY));
+    buildSites();
+}
+
+void Row::buildSites() {
+    // Initialize sites, all free; padding bits in the last word count as occupied
+    int wordCount = (std::max(siteCount, 0) + WordBits - 1) / WordBits;
+    occupiedBits.assign(wordCount, 0);
+    if (siteCount % WordBits != 0) {
+        occupiedBits.back() = bitsFrom(siteCount % WordBits);
+    }
+    siteCells.assign(std::max(siteCount, 0), -1);
+}
+
+double Row::siteX(int site) const {
+    return originX + site * siteWidth;
+}
+
+bool Row::isOccupied(int site) const {
+    return (occupiedBits[site / WordBits] >> (site % WordBits)) & 1;
+}
+
+int Row::nextFree(int site) const {
+    // First free site at or after site, or siteCount if none
+    if (site >= siteCount) return siteCount;
+    int word = site / WordBits;
+    uint64_t bits = ~occupiedBits[word] & bitsFrom(site % WordBits);
+    while (bits == 0) {
+        if (++word == static_cast<int>(occupiedBits.size())) return siteCount;
+        bits = ~occupiedBits[word];
+    }
+    return std::min(word * WordBits + __builtin_ctzll(bits), siteCount);
+}
+
+int Row::nextOccupied(int site) const {
+    // First occupied site at or after site, or siteCount if none
+    if (site >= siteCount) return siteCount;
+    int word = site / WordBits;
+    uint64_t bits = occupiedBits[word] & bitsFrom(site % WordBits);
+    while (bits == 0) {
+        if (++word == static_cast<int>(occupiedBits.size())) return siteCount;
+        bits = occupiedBits[word];
+    }
+    return std::min(word * WordBits + __builtin_ctzll(bits), siteCount);
+}
+
+int Row::previousFree(int site) const {
+    // Last free site at or before site, or -1 if none
+    if (site < 0) return -1;
+    int word = site / WordBits;
+    uint64_t bits = ~occupiedBits[word] & bitsThrough(site % WordBits);
+    while (bits == 0) {
+        if (word-- == 0) return -1;
+        bits = ~occupiedBits[word];
     }
+    return word * WordBits + WordBits - 1 - __builtin_clzll(bits);
+}
+
+int Row::previousOccupied(int site) const {
+    // Last occupied site at or before site, or -1 if none
+    if (site < 0) return -1;
+    int word = site / WordBits;
+    uint64_t bits = occupiedBits[word] & bitsThrough(site % WordBits);
+    while (bits == 0) {
+        if (word-- == 0) return -1;
+        bits = occupiedBits[word];
+    }
+    return word * WordBits + WordBits - 1 - __builtin_clzll(bits);
+}
+
+void Row::markRange(int start, int end, bool occupied) {
+    for (int word = start / WordBits; word * WordBits < end; ++word) {
+        int low = std::max(start - word * WordBits, 0);
+        int high = std::min(end - word * WordBits, WordBits) - 1;
+        uint64_t mask = bitsFrom(low) & bitsThrough(high);
+        if (occupied) {
+            occupiedBits[word] |= mask;
+        } else {
+            occupiedBits[word] &= ~mask;
+        }
+    }
+}
+
+int Row::findFirstFreeRun(int from, int sitesNeeded) const {
+    // Returns the start of the leftmost run of sitesNeeded free sites at or after
+    // from, or -1 if there is none
+    if (sitesNeeded <= 0) return -1;
+    int start = nextFree(std::max(from, 0));
+    while (start + sitesNeeded <= siteCount) {
+        int end = nextOccupied(start);
+        if (end - start >= sitesNeeded) return start;
+        start = nextFree(end);
+    }
+    return -1;
+}
+
+int Row::findLastFreeRun(int upTo, int sitesNeeded) const {
+    // Returns the start of the rightmost run of sitesNeeded free sites starting at
+    // or before upTo, or -1 if there is none
+    if (sitesNeeded <= 0) return -1;
+    int start = std::min(upTo, siteCount - sitesNeeded);
+    while (start >= 0) {
+        int blocker = previousOccupied(start + sitesNeeded - 1);
+        if (blocker < start) return start;
+        start = blocker - sitesNeeded;
+    }
+    return -1;
+}
+
+int Row::findNearestFreeRun(double targetX, int sitesNeeded, double& bestDistance) const {
+    // Returns the start site of the free run of sitesNeeded sites closest to targetX,
+    // preferring the leftmost one on ties, or -1 if no run is within bestDistance.
+    // On success bestDistance is lowered to the distance of the returned run.
+    int bestStart = -1;
+    if (sitesNeeded <= 0 || siteCount <= 0) return bestStart;
+
+    double target = (targetX - originX) / siteWidth;
+    auto consider = [&](int start, int end) {
+        int lastStart = end - sitesNeeded;
+        if (lastStart < start) return;
+        int candidates[2] = {static_cast<int>(std::floor(target)), static_cast<int>(std::ceil(target))};
+        for (int candidate : candidates) {
+            int i = std::min(std::max(candidate, start), lastStart);
+            double distance = std::abs(siteX(i) - targetX);
+            if (distance > bestDistance) continue;
+            if (bestStart < 0 || distance < bestDistance || i < bestStart) {
+                bestDistance = distance;
+                bestStart = i;
+            }
+        }
+    };
+
+    // Walk right over free runs from the one containing the target site, then
+    // left, stopping once a run cannot beat the best distance found so far.
+    int pivot = static_cast<int>(std::min(std::max(std::floor(target), 0.0), siteCount - 1.0));
+    int first = isOccupied(pivot) ? nextFree(pivot) : previousOccupied(pivot) + 1;
+    for (int start = first; start < siteCount; ) {
+        if ((start - target) * siteWidth > bestDistance) break;
+        int end = nextOccupied(start);
+        consider(start, end);
+        start = nextFree(end);
+    }
+    for (int last = previousFree(first - 1); last >= 0; ) {
+        int end = last + 1;
+        if ((target - (end - sitesNeeded)) * siteWidth > bestDistance) break;
+        int start = previousOccupied(last) + 1;
+        consider(start, end);
+        last = previousFree(start - 1);
+    }
+    return bestStart;
+}
+
+std::vector<std::pair<int, int>> Row::freeSegments() const {
+    // Maximal runs of free sites as [start, end) pairs, left to right
+    std::vector<std::pair<int, int>> segments;
+    for (int start = nextFree(0); start < siteCount; ) {
+        int end = nextOccupied(start);
+        segments.emplace_back(start, end);
+        start = nextFree(end);
+    }
+    return segments;
+}
+
+void Row::occupy(int start, int count, int cell) {
+    int end = std::min(start + count, siteCount);
+    if (start >= end) return;
+    std::fill(siteCells.begin() + start, siteCells.begin() + end, cell);
+    markRange(start, end, true);
+}
+
+void Row::release(int start, int count) {
+    int end = std::min(start + count, siteCount);
+    if (start >= end) return;
+    std::fill(siteCells.begin() + start, siteCells.begin() + end, -1);
+    markRange(start, end, false);
 }
@@ -9,14 +9,22 @@
 #ifndef ROW_H
 #define ROW_H
 
+#include <cstdint>
+#include <utility>
 #include <vector>
-#include <memory>
-
-class Site;
 
 class Row {
 public:
     Row(double originX, double originY, double siteWidth, int siteCount);
+    void buildSites();
+    double siteX(int site) const;
+    bool isOccupied(int site) const;
+    int findFirstFreeRun(int from, int sitesNeeded) const;
+    int findLastFreeRun(int upTo, int sitesNeeded) const;
+    int findNearestFreeRun(double targetX, int sitesNeeded, double& bestDistance) const;
+    std::vector<std::pair<int, int>> freeSegments() const;
+    void occupy(int start, int count, int cell);
+    void release(int start, int count);
 
     double originX;
     double originY;
@@ -24,7 +32,19 @@ public:
     double siteWidth;
     int siteCount;
 
-    std::vector<std::shared_ptr<Site>> sites;
+    // Id of the cell covering each site, -1 if free
+    std::vector<int> siteCells;
+
+private:
+    int nextFree(int site) const;
+    int nextOccupied(int site) const;
+    int previousFree(int site) const;
+    int previousOccupied(int site) const;
+    void markRange(int start, int end, bool occupied);
+
+    // One bit per site, set when occupied; bits past siteCount are kept set
+    // so forward scans stop at the end of the row
+    std::vector<uint64_t> occupiedBits;
 };
 
 #endif // ROW_H
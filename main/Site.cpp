@@ -1,11 +0,0 @@
-///////////////////////////
-// File: Site.cpp        //
-// Author: Shiina        //
-// Date: 2024/10/31      //
-// Version: 1.0          //
-// copiright 2024        //
-///////////////////////////
-
-#include "Site.h"
-
-Site::Site(double x, double y) : x(x), y(y), isOccupied(false), cell(nullptr) {}
@@ -0,0 +1,351 @@
+///////////////////////////
+// File: Snapshot.cpp    //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#include "Snapshot.h"
+#include "CellStore.h"
+#include "NetStore.h"
+#include "Row.h"
+#include "Tokenizer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char Magic[8] = {'L', 'E', 'G', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t Version = 1;
+const uint32_t ByteOrderMark = 0x01020304;
+
+// Section types; new ones get new numbers, existing ones never change layout
+enum SectionId : uint32_t {
+    DesignSection = 1,       // DesignRecord
+    CellXSection,            // double per cell, current (legalized) positions
+    CellYSection,
+    WidthSection,
+    HeightSection,
+    OriginalXSection,        // double per cell, global placement positions
+    OriginalYSection,
+    FixedSection,            // char per cell
+    OrientationIdSection,    // int32 per cell
+    NameOffsetSection,       // uint64 per cell
+    NameCharSection,         // null-terminated names back to back
+    OrientationNameSection,  // null-terminated orientation names back to back
+    RowSection,              // RowRecord per row
+    NetSection,              // NetRecord; the net sections are absent in older files
+    NetPinStartSection,      // int32 per net, plus one
+    NetWeightSection,        // double per net
+    PinCellSection,          // int32 per pin
+    PinOffsetXSection,       // double per pin, from the cell center
+    PinOffsetYSection
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t sectionCount;
+    uint32_t reserved;
+};
+
+struct SectionEntry {
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct DesignRecord {
+    double siteWidth;
+    double siteHeight;
+    uint64_t cellCount;
+    uint64_t rowCount;
+};
+
+struct NetRecord {
+    uint64_t netCount;
+    uint64_t pinCount;
+};
+
+struct RowRecord {
+    double originX;
+    double originY;
+    double height;
+    double siteWidth;
+    int32_t siteCount;
+    int32_t reserved;
+};
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+struct SectionData {
+    uint32_t id;
+    const void* data;
+    uint64_t size;
+};
+
+template <typename T>
+SectionData section(uint32_t id, const std::vector<T>& values) {
+    SectionData result = {id, values.data(), values.size() * sizeof(T)};
+    return result;
+}
+
+// Looks sections up in a loaded file and checks their sizes
+class SectionReader {
+public:
+    SectionReader(const char* data, size_t size, const SectionEntry* entries, uint32_t count)
+        : data(data), size(size), entries(entries), count(count) {}
+
+    const char* find(uint32_t id, uint64_t expectedSize) const {
+        for (uint32_t i = 0; i < count; ++i) {
+            const SectionEntry& entry = entries[i];
+            if (entry.id != id) continue;
+            if (entry.offset > size || entry.size > size - entry.offset) return nullptr;
+            if (expectedSize != UINT64_MAX && entry.size != expectedSize) return nullptr;
+            return data + entry.offset;
+        }
+        return nullptr;
+    }
+
+    uint64_t sizeOf(uint32_t id) const {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (entries[i].id == id) return entries[i].size;
+        }
+        return 0;
+    }
+
+    template <typename T>
+    bool read(uint32_t id, uint64_t elementCount, std::vector<T>& values) const {
+        const char* source = find(id, elementCount * sizeof(T));
+        if (!source) return false;
+        values.resize(elementCount);
+        if (elementCount > 0) std::memcpy(values.data(), source, elementCount * sizeof(T));
+        return true;
+    }
+
+private:
+    const char* data;
+    size_t size;
+    const SectionEntry* entries;
+    uint32_t count;
+};
+
+} // namespace
+
+bool Snapshot::save(const std::string& path, const CellStore& cells, const NetStore& nets,
+                    const std::vector<std::shared_ptr<Row>>& rows, double siteWidth, double siteHeight) {
+    DesignRecord design = {siteWidth, siteHeight, static_cast<uint64_t>(cells.size()), rows.size()};
+
+    std::vector<uint64_t> nameOffsets(cells.nameOffsets.begin(), cells.nameOffsets.end());
+    std::vector<int32_t> orientationIds(cells.orientationIds.begin(), cells.orientationIds.end());
+    std::vector<char> orientationNames;
+    for (const auto& orientation : cells.orientations) {
+        orientationNames.insert(orientationNames.end(), orientation.begin(), orientation.end());
+        orientationNames.push_back('\0');
+    }
+    std::vector<RowRecord> rowRecords;
+    for (const auto& row : rows) {
+        RowRecord record = {row->originX, row->originY, row->height, row->siteWidth, row->siteCount, 0};
+        rowRecords.push_back(record);
+    }
+
+    NetRecord netRecord = {static_cast<uint64_t>(nets.size()), static_cast<uint64_t>(nets.pinCount())};
+    std::vector<int32_t> netPinStart(nets.netPinStart.begin(), nets.netPinStart.end());
+    std::vector<int32_t> pinCell(nets.pinCell.begin(), nets.pinCell.end());
+
+    SectionData designSection = {DesignSection, &design, sizeof(design)};
+    SectionData netSection = {NetSection, &netRecord, sizeof(netRecord)};
+    std::vector<SectionData> sections = {
+        designSection,
+        section(CellXSection, cells.x),
+        section(CellYSection, cells.y),
+        section(WidthSection, cells.width),
+        section(HeightSection, cells.height),
+        section(OriginalXSection, cells.originalX),
+        section(OriginalYSection, cells.originalY),
+        section(FixedSection, cells.isFixed),
+        section(OrientationIdSection, orientationIds),
+        section(NameOffsetSection, nameOffsets),
+        section(NameCharSection, cells.nameChars),
+        section(OrientationNameSection, orientationNames),
+        section(RowSection, rowRecords),
+        netSection,
+        section(NetPinStartSection, netPinStart),
+        section(NetWeightSection, nets.weight),
+        section(PinCellSection, pinCell),
+        section(PinOffsetXSection, nets.pinOffsetX),
+        section(PinOffsetYSection, nets.pinOffsetY)
+    };
+
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.sectionCount = static_cast<uint32_t>(sections.size());
+    header.reserved = 0;
+
+    std::vector<SectionEntry> entries;
+    uint64_t offset = alignUp(sizeof(Header) + sections.size() * sizeof(SectionEntry));
+    for (const auto& data : sections) {
+        SectionEntry entry = {data.id, 0, offset, data.size};
+        entries.push_back(entry);
+        offset = alignUp(offset + data.size);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open snapshot file: " << path << std::endl;
+        return false;
+    }
+    const char padding[8] = {0};
+    uint64_t written = sizeof(Header) + entries.size() * sizeof(SectionEntry);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(SectionEntry));
+    for (size_t i = 0; i < sections.size(); ++i) {
+        file.write(padding, entries[i].offset - written);
+        file.write(static_cast<const char*>(sections[i].data), sections[i].size);
+        written = entries[i].offset + sections[i].size;
+    }
+    if (!file) {
+        std::cerr << "Failed to write snapshot file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::load(const std::string& path, CellStore& cells, NetStore& nets,
+                    std::vector<std::shared_ptr<Row>>& rows, double& siteWidth, double& siteHeight) {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        std::cerr << "Failed to open snapshot file: " << path << std::endl;
+        return false;
+    }
+
+    Header header;
+    if (file.size() < sizeof(Header)) {
+        std::cerr << "Invalid snapshot file: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.byteOrder != ByteOrderMark ||
+        file.size() < sizeof(Header) + static_cast<uint64_t>(header.sectionCount) * sizeof(SectionEntry)) {
+        std::cerr << "Invalid snapshot file: " << path << std::endl;
+        return false;
+    }
+    if (header.version > Version) {
+        std::cerr << "Unsupported snapshot version " << header.version << " in " << path << std::endl;
+        return false;
+    }
+
+    SectionReader reader(file.data(), file.size(), reinterpret_cast<const SectionEntry*>(file.data() + sizeof(Header)),
+                         header.sectionCount);
+    const char* designData = reader.find(DesignSection, sizeof(DesignRecord));
+    if (!designData) {
+        std::cerr << "Snapshot is missing its design section: " << path << std::endl;
+        return false;
+    }
+    DesignRecord design;
+    std::memcpy(&design, designData, sizeof(design));
+
+    CellStore loaded;
+    std::vector<uint64_t> nameOffsets;
+    std::vector<int32_t> orientationIds;
+    std::vector<char> orientationNames;
+    std::vector<RowRecord> rowRecords;
+    uint64_t cellCount = design.cellCount;
+    bool complete = reader.read(CellXSection, cellCount, loaded.x) &&
+                    reader.read(CellYSection, cellCount, loaded.y) &&
+                    reader.read(WidthSection, cellCount, loaded.width) &&
+                    reader.read(HeightSection, cellCount, loaded.height) &&
+                    reader.read(OriginalXSection, cellCount, loaded.originalX) &&
+                    reader.read(OriginalYSection, cellCount, loaded.originalY) &&
+                    reader.read(FixedSection, cellCount, loaded.isFixed) &&
+                    reader.read(OrientationIdSection, cellCount, orientationIds) &&
+                    reader.read(NameOffsetSection, cellCount, nameOffsets) &&
+                    reader.read(NameCharSection, reader.sizeOf(NameCharSection), loaded.nameChars) &&
+                    reader.read(OrientationNameSection, reader.sizeOf(OrientationNameSection), orientationNames) &&
+                    reader.read(RowSection, design.rowCount, rowRecords);
+    if (!complete) {
+        std::cerr << "Snapshot is truncated or missing cell data: " << path << std::endl;
+        return false;
+    }
+
+    // Rebuild what is derived rather than stored
+    for (size_t i = 0; i < orientationNames.size(); ) {
+        loaded.orientations.push_back(orientationNames.data() + i);
+        i += loaded.orientations.back().size() + 1;
+    }
+    for (uint64_t cell = 0; cell < cellCount; ++cell) {
+        if (nameOffsets[cell] >= loaded.nameChars.size() || orientationIds[cell] < 0 ||
+            orientationIds[cell] >= static_cast<int32_t>(loaded.orientations.size())) {
+            std::cerr << "Snapshot has inconsistent cell data: " << path << std::endl;
+            return false;
+        }
+    }
+    if (!loaded.nameChars.empty() && loaded.nameChars.back() != '\0') {
+        std::cerr << "Snapshot has inconsistent cell data: " << path << std::endl;
+        return false;
+    }
+    loaded.nameOffsets.assign(nameOffsets.begin(), nameOffsets.end());
+    loaded.orientationIds.assign(orientationIds.begin(), orientationIds.end());
+    loaded.density.assign(cellCount, 0);
+    loaded.nameIndex.reserve(cellCount);
+    for (uint64_t cell = 0; cell < cellCount; ++cell) {
+        loaded.nameIndex.emplace(loaded.name(static_cast<int>(cell)), static_cast<int>(cell));
+    }
+
+    // Nets are optional so snapshots written before they existed still load
+    NetStore loadedNets;
+    const char* netData = reader.find(NetSection, sizeof(NetRecord));
+    if (netData) {
+        NetRecord netRecord;
+        std::memcpy(&netRecord, netData, sizeof(netRecord));
+        std::vector<int32_t> netPinStart;
+        std::vector<int32_t> pinCell;
+        bool netsComplete = reader.read(NetPinStartSection, netRecord.netCount + 1, netPinStart) &&
+                            reader.read(NetWeightSection, netRecord.netCount, loadedNets.weight) &&
+                            reader.read(PinCellSection, netRecord.pinCount, pinCell) &&
+                            reader.read(PinOffsetXSection, netRecord.pinCount, loadedNets.pinOffsetX) &&
+                            reader.read(PinOffsetYSection, netRecord.pinCount, loadedNets.pinOffsetY);
+        bool consistent = netsComplete && netPinStart[0] == 0 &&
+                          netPinStart.back() == static_cast<int32_t>(netRecord.pinCount);
+        for (uint64_t net = 0; consistent && net < netRecord.netCount; ++net) {
+            consistent = netPinStart[net] <= netPinStart[net + 1];
+        }
+        for (uint64_t pin = 0; consistent && pin < netRecord.pinCount; ++pin) {
+            consistent = pinCell[pin] >= 0 && static_cast<uint64_t>(pinCell[pin]) < cellCount;
+        }
+        if (!consistent) {
+            std::cerr << "Snapshot has inconsistent net data: " << path << std::endl;
+            return false;
+        }
+        loadedNets.netPinStart.assign(netPinStart.begin(), netPinStart.end());
+        loadedNets.pinCell.assign(pinCell.begin(), pinCell.end());
+        loadedNets.pinNet.resize(netRecord.pinCount);
+        for (uint64_t net = 0; net < netRecord.netCount; ++net) {
+            std::fill(loadedNets.pinNet.begin() + netPinStart[net], loadedNets.pinNet.begin() + netPinStart[net + 1],
+                      static_cast<int>(net));
+        }
+    }
+    loadedNets.buildCellIndex(static_cast<int>(cellCount));
+
+    cells = std::move(loaded);
+    nets = std::move(loadedNets);
+    rows.clear();
+    for (const auto& record : rowRecords) {
+        auto row = std::make_shared<Row>(record.originX, record.originY, record.siteWidth, record.siteCount);
+        row->height = record.height;
+        rows.push_back(row);
+    }
+    siteWidth = design.siteWidth;
+    siteHeight = design.siteHeight;
+    return true;
+}
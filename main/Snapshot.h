@@ -0,0 +1,33 @@
+///////////////////////////
+// File: Snapshot.h      //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+class CellStore;
+class NetStore;
+class Row;
+
+// Binary image of a parsed design: cells with their original and current
+// positions, the rows and the nets. The file is a header, a table of typed sections
+// and the section payloads, each 8-byte aligned, so loading is a few copies
+// out of a memory-mapped file. Readers skip section types they do not know,
+// which lets new data be added without breaking older snapshots.
+class Snapshot {
+public:
+    static bool save(const std::string& path, const CellStore& cells, const NetStore& nets,
+                     const std::vector<std::shared_ptr<Row>>& rows, double siteWidth, double siteHeight);
+    static bool load(const std::string& path, CellStore& cells, NetStore& nets,
+                     std::vector<std::shared_ptr<Row>>& rows, double& siteWidth, double& siteHeight);
+};
+
+#endif // SNAPSHOT_H
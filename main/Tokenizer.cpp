@@ -0,0 +1,196 @@
+///////////////////////////
+// File: Tokenizer.cpp   //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#include "Tokenizer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+bool isDelimiter(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == ':' || ch == '\f' || ch == '\v';
+}
+
+// Powers of ten that are exact in a double
+const double ExactPowers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+} // namespace
+
+bool Token::operator==(const char* text) const {
+    return std::strncmp(data, text, length) == 0 && text[length] == '\0';
+}
+
+bool Token::operator!=(const char* text) const {
+    return !(*this == text);
+}
+
+std::string Token::str() const {
+    return std::string(data, length);
+}
+
+bool Token::toDouble(double& value) const {
+    // Plain decimals with at most 15 digits and a small exponent are exact as
+    // integer * or / power of ten, which rounds the same way strtod does.
+    // Anything else goes through strtod on a null-terminated copy.
+    const char* p = data;
+    const char* last = data + length;
+    bool negative = false;
+    if (p < last && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    for (; p < last && *p >= '0' && *p <= '9'; ++p, ++digits) {
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p < last && *p == '.') {
+        for (++p; p < last && *p >= '0' && *p <= '9'; ++p, ++digits, --exponent) {
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+    }
+    if (p == last && digits > 0 && digits <= 15 && exponent >= -22) {
+        double result = exponent < 0 ? mantissa / ExactPowers[-exponent] : static_cast<double>(mantissa);
+        value = negative ? -result : result;
+        return true;
+    }
+
+    char text[64];
+    if (length == 0 || length >= sizeof(text)) return false;
+    std::memcpy(text, data, length);
+    text[length] = '\0';
+    char* parsedEnd = nullptr;
+    double result = std::strtod(text, &parsedEnd);
+    if (parsedEnd != text + length) return false;
+    value = result;
+    return true;
+}
+
+bool Token::toInt(int& value) const {
+    const char* p = data;
+    const char* last = data + length;
+    bool negative = false;
+    if (p < last && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+    if (p == last) return false;
+
+    long long result = 0;
+    for (; p < last; ++p) {
+        if (*p < '0' || *p > '9') return false;
+        result = result * 10 + (*p - '0');
+        if (result > 2147483648LL) return false;
+    }
+    if (negative) result = -result;
+    if (result > 2147483647LL) return false;
+    value = static_cast<int>(result);
+    return true;
+}
+
+MappedFile::MappedFile(const std::string& path) : opened(false), mapping(nullptr), mappingSize(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    opened = true;
+
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        mappingSize = static_cast<size_t>(info.st_size);
+        mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            mappingSize = 0;
+        } else {
+            ::madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+        }
+    }
+
+    // Fall back to reading the whole file, e.g. for pipes or special files
+    if (!mapping) {
+        char chunk[1 << 16];
+        ssize_t count;
+        while ((count = ::read(fd, chunk, sizeof(chunk))) > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + count);
+        }
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (mapping) ::munmap(mapping, mappingSize);
+}
+
+bool MappedFile::isOpen() const {
+    return opened;
+}
+
+const char* MappedFile::data() const {
+    return mapping ? static_cast<const char*>(mapping) : buffer.data();
+}
+
+size_t MappedFile::size() const {
+    return mapping ? mappingSize : buffer.size();
+}
+
+std::vector<size_t> MappedFile::splitLines(int parts) const {
+    // Returns parts + 1 offsets cutting the file into roughly equal ranges that
+    // each start at the beginning of a line; some ranges may be empty
+    std::vector<size_t> bounds(1, 0);
+    const char* text = data();
+    size_t length = size();
+    for (int i = 1; i < parts; ++i) {
+        size_t offset = std::max(bounds.back(), length / parts * i);
+        const void* newline = offset < length ? std::memchr(text + offset, '\n', length - offset) : nullptr;
+        offset = newline ? static_cast<const char*>(newline) - text + 1 : length;
+        bounds.push_back(std::max(offset, bounds.back()));
+    }
+    bounds.push_back(length);
+    return bounds;
+}
+
+Tokenizer::Tokenizer(const MappedFile& file) : Tokenizer(file.data(), file.data() + file.size()) {}
+
+Tokenizer::Tokenizer(const char* begin, const char* end)
+    : end(end), lineStart(begin), lineEnd(begin), cursor(begin), nextRead(begin) {}
+
+bool Tokenizer::nextLine() {
+    // Moves to the next line that has a token and is not a comment
+    while (nextRead < end) {
+        lineStart = nextRead;
+        const void* newline = std::memchr(lineStart, '\n', end - lineStart);
+        lineEnd = newline ? static_cast<const char*>(newline) : end;
+        nextRead = newline ? lineEnd + 1 : end;
+
+        cursor = lineStart;
+        while (cursor < lineEnd && isDelimiter(*cursor)) ++cursor;
+        if (cursor < lineEnd && *cursor != '#') return true;
+    }
+    lineStart = lineEnd = cursor = end;
+    return false;
+}
+
+bool Tokenizer::next(Token& token) {
+    // Reads the next token of the current line; false once the line is exhausted
+    while (cursor < lineEnd && isDelimiter(*cursor)) ++cursor;
+    if (cursor == lineEnd) return false;
+    token.data = cursor;
+    while (cursor < lineEnd && !isDelimiter(*cursor)) ++cursor;
+    token.length = static_cast<size_t>(cursor - token.data);
+    return true;
+}
+
+std::string Tokenizer::line() const {
+    const char* last = lineEnd;
+    if (last > lineStart && last[-1] == '\r') --last;
+    return std::string(lineStart, last);
+}
@@ -0,0 +1,68 @@
+///////////////////////////
+// File: Tokenizer.h     //
+// Author: Shiina        //
+// Date: 2024/10/31      //
+// Version: 1.0          //
+// copiright 2024        //
+///////////////////////////
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A token points into the tokenizer's buffer and is not null-terminated
+struct Token {
+    const char* data;
+    size_t length;
+
+    bool operator==(const char* text) const;
+    bool operator!=(const char* text) const;
+    std::string str() const;
+    bool toDouble(double& value) const;
+    bool toInt(int& value) const;
+};
+
+// Read-only view of a whole file: memory mapped, or read into a buffer if
+// mapping fails
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const;
+    const char* data() const;
+    size_t size() const;
+    std::vector<size_t> splitLines(int parts) const;
+
+private:
+    bool opened;
+    void* mapping;
+    size_t mappingSize;
+    std::vector<char> buffer;
+};
+
+// Splits a range of a Bookshelf file into lines and tokens in place. Tokens
+// are separated by whitespace and ':'; blank and '#' comment lines are skipped.
+class Tokenizer {
+public:
+    explicit Tokenizer(const MappedFile& file);
+    Tokenizer(const char* begin, const char* end);
+
+    bool nextLine();
+    bool next(Token& token);
+    std::string line() const;
+
+private:
+    const char* end;
+    const char* lineStart;
+    const char* lineEnd;
+    const char* cursor;   // Next unread character of the current line
+    const char* nextRead; // Start of the line after the current one
+};
+
+#endif // TOKENIZER_H
@@ -7,16 +7,113 @@
 ///////////////////////////
 
 #include "Utilities.h"
-#include "Cell.h"
+#include "CellStore.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
 #include <sys/stat.h> // For mkdir
 #include <cstring>    // For strerror
+#include <cstdio>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h> // For FICLONE
+#endif
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+namespace {
+
+// Appends value formatted the way an ostream does by default (printf "%g")
+void appendNumber(std::string& out, double value) {
+    // Under %g integers below 1e6 are printed as plain digits; legalized
+    // coordinates are almost all integers, so they skip snprintf
+    if (value == std::floor(value) && std::abs(value) < 1e6 && !(value == 0 && std::signbit(value))) {
+        long long integer = static_cast<long long>(value);
+        if (integer < 0) out += '-';
+        unsigned long long magnitude = integer < 0 ? -integer : integer;
+        char digits[8];
+        int count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude > 0);
+        while (count > 0) out += digits[--count];
+        return;
+    }
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "%g", value);
+    out.append(text, length);
+}
+
+// Copies source to target without going through user-space buffers where the
+// kernel allows: a reflink (FICLONE), then copy_file_range, then plain
+// read/write. With linkInputs a hard link is tried first, so target then
+// shares its storage with source.
+bool copyUnchanged(const std::string& source, const std::string& target, bool linkInputs) {
+    struct stat sourceInfo, targetInfo;
+    if (stat(source.c_str(), &sourceInfo) != 0) {
+        std::cerr << "Failed to open input file: " << source << std::endl;
+        return false;
+    }
+    bool sameFile = stat(target.c_str(), &targetInfo) == 0 && targetInfo.st_dev == sourceInfo.st_dev &&
+                    targetInfo.st_ino == sourceInfo.st_ino;
+    // Writing over a link to the input would truncate the input itself
+    if (sameFile && (linkInputs || sourceInfo.st_nlink == 1)) return true;
+    if (sameFile || linkInputs) {
+        unlink(target.c_str());
+    }
+    if (linkInputs && link(source.c_str(), target.c_str()) == 0) return true;
+
+    int in = open(source.c_str(), O_RDONLY);
+    if (in < 0) {
+        std::cerr << "Failed to open input file: " << source << std::endl;
+        return false;
+    }
+    int out = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        std::cerr << "Failed to open output file: " << target << std::endl;
+        close(in);
+        return false;
+    }
+
+    bool copied = false;
+#ifdef FICLONE
+    copied = ioctl(out, FICLONE, in) == 0;
+#endif
+#ifdef __linux__
+    // copy_file_range advances both file offsets, so a partial copy can be
+    // finished by the read/write loop below
+    while (!copied) {
+        ssize_t count = copy_file_range(in, nullptr, out, nullptr, 1 << 30, 0);
+        if (count < 0) break;
+        copied = count == 0;
+    }
+#endif
+    char chunk[1 << 16];
+    ssize_t count = 0;
+    while (!copied && (count = read(in, chunk, sizeof(chunk))) > 0) {
+        if (write(out, chunk, count) != count) {
+            count = -1;
+            break;
+        }
+    }
+    close(in);
+    if (close(out) != 0 || count < 0) {
+        std::cerr << "Failed to write output file: " << target << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
 
 void Utilities::writeOutput(const std::string& inputPath, const std::string& inputFilePrefix, const std::string& outputPath, const std::string& outputFilePrefix,
-                            const std::vector<std::shared_ptr<Cell>>& cells,
-                            const std::vector<std::shared_ptr<Row>>& rows) {
+                            const CellStore& cells,
+                            const std::vector<std::shared_ptr<Row>>& rows, bool linkInputs) {
     // Create output directory if it doesn't exist
     struct stat info;
     if (stat(outputPath.c_str(), &info) != 0) {
@@ -27,40 +124,42 @@ void Utilities::writeOutput(const std::string& inputPath, const std::string& inp
         }
     }
 
-    // Write .pl file
-    std::ofstream plFile(outputPath + outputFilePrefix + ".pl");
-    if (!plFile.is_open()) {
+    // Write .pl file, formatting into a large buffer that is written out in blocks
+    std::string plPath = outputPath + outputFilePrefix + ".pl";
+    std::FILE* plFile = std::fopen(plPath.c_str(), "wb");
+    if (!plFile) {
         std::cerr << "Failed to open output .pl file." << std::endl;
         return;
     }
 
-    plFile << "UCLA pl 1.0 \n" << std::endl;
-    for (auto& cell : cells) {
-        plFile << cell->name << "\t" << cell->x << "\t" << cell->y << " : " << cell->orientation << std::endl;
+    const size_t blockSize = 1 << 20;
+    std::string buffer;
+    buffer.reserve(blockSize + 256);
+    buffer += "UCLA pl 1.0 \n\n";
+    for (int cell = 0; cell < cells.size(); ++cell) {
+        buffer += cells.name(cell);
+        buffer += '\t';
+        appendNumber(buffer, cells.x[cell]);
+        buffer += '\t';
+        appendNumber(buffer, cells.y[cell]);
+        buffer += " : ";
+        buffer += cells.orientation(cell);
+        if (cells.isFixed[cell] & CellStore::FixedPlacement) buffer += " /FIXED";
+        buffer += '\n';
+        if (buffer.size() >= blockSize) {
+            std::fwrite(buffer.data(), 1, buffer.size(), plFile);
+            buffer.clear();
+        }
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), plFile);
+    if (std::fclose(plFile) != 0) {
+        std::cerr << "Failed to write output .pl file." << std::endl;
     }
-    plFile.close();
 
-    // List of files to copy
+    // Copy the files legalization does not change
     std::vector<std::string> filesToCopy = {".nodes", ".scl", ".nets", ".wts"};
-
     for (const auto& extension : filesToCopy) {
-        std::ifstream inFile(inputPath + inputFilePrefix + extension, std::ios::binary);
-        if (!inFile.is_open()) {
-            std::cerr << "Failed to open input file: " << inputPath + inputFilePrefix + extension << std::endl;
-            continue;
-        }
-
-        std::ofstream outFile(outputPath + outputFilePrefix + extension, std::ios::binary);
-        if (!outFile.is_open()) {
-            std::cerr << "Failed to open output file: " << outputPath + outputFilePrefix + extension << std::endl;
-            inFile.close();
-            continue;
-        }
-
-        outFile << inFile.rdbuf();
-
-        inFile.close();
-        outFile.close();
+        copyUnchanged(inputPath + inputFilePrefix + extension, outputPath + outputFilePrefix + extension, linkInputs);
     }
 
     // Write .aux file with updated content
@@ -87,3 +186,29 @@ void Utilities::writeOutput(const std::string& inputPath, const std::string& inp
         }
     }
 }
+
+
+void Utilities::parallelFor(int count, int threadCount, const std::function<void(int)>& body) {
+    int workers = std::min(threadCount, count);
+    if (workers <= 1) {
+        for (int i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++) {
+            body(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < workers; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
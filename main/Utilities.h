@@ -12,14 +12,19 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
 
-class Cell;
+class CellStore;
 class Row;
 
 namespace Utilities {
     void writeOutput(const std::string& inputPath, const std::string& inputFilePrefix, const std::string& outputPath, const std::string& outputFilePrefix,
-                     const std::vector<std::shared_ptr<Cell>>& cells,
-                     const std::vector<std::shared_ptr<Row>>& rows);
+                     const CellStore& cells,
+                     const std::vector<std::shared_ptr<Row>>& rows, bool linkInputs = false);
+
+    // Runs body(i) for every i in [0, count) on up to threadCount threads.
+    // Work is handed out dynamically; with one thread it runs inline in order.
+    void parallelFor(int count, int threadCount, const std::function<void(int)>& body);
 }
 
 #endif // UTILITIES_H
\ No newline at end of file
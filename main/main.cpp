@@ -8,26 +8,44 @@
 
 #include <iostream>
 #include <string>
-#include <cstdlib>  // For std::strtod
+#include <cstdlib>  // For std::strtod, std::atoi, std::atoll
 #include "Parser.h"
 #include "Legalizer.h"
 #include "Utilities.h"
+#include "NetBoxCache.h"
+#include "Snapshot.h"
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cout << "Usage: legalizer INPUT_DIR OUTPUT_DIR [-e double] [-t double]" << std::endl;
+        std::cout << "Usage: legalizer INPUT_DIR OUTPUT_DIR [-e double] [-t double] [-j int] [--replicas int] [--mode greedy|abacus|tetris] [--brute-density] [--hpwl-weight double] [--max-displacement double] [--no-refine] [--cooling lam|geometric] [--stall-moves int] [--min-gain double] [--eco-baseline file] [--load-snapshot file] [--save-snapshot file] [--parse-only] [--link-inputs]" << std::endl;
         return 1;
     }
 
     // Handle help argument
     for (int i = 1; i < argc; ++i) {
         if (std::string(argv[i]) == "-h" || std::string(argv[i]) == "--help") {
-            std::cout << "Usage: legalizer INPUT_DIR OUTPUT_DIR [-e double] [-t double]\n";
+            std::cout << "Usage: legalizer INPUT_DIR OUTPUT_DIR [-e double] [-t double] [-j int] [--replicas int] [--mode greedy|abacus|tetris] [--brute-density] [--hpwl-weight double] [--max-displacement double] [--no-refine] [--cooling lam|geometric] [--stall-moves int] [--min-gain double] [--eco-baseline file] [--load-snapshot file] [--save-snapshot file] [--parse-only] [--link-inputs]\n";
             std::cout << "\nArguments:\n";
-            std::cout << "  INPUT_DIR           Directory containing input files.\n";
-            std::cout << "  OUTPUT_DIR          Directory to save output files.\n";
-            std::cout << "  -e double           Optional. Set epsilon value (default: 10.0).\n";
-            std::cout << "  -t double           Optional. Set timer in minutes (default: 5.0).\n";
+            std::cout << "  INPUT_DIR             Directory containing input files.\n";
+            std::cout << "  OUTPUT_DIR            Directory to save output files.\n";
+            std::cout << "  -e double             Optional. Set epsilon value (default: 10.0).\n";
+            std::cout << "  -t double             Optional. Set timer in minutes (default: 5.0).\n";
+            std::cout << "  -j int                Optional. Number of parsing and annealing threads (default: 1).\n";
+            std::cout << "  --replicas int        Optional. Anneal with this many exchanging replicas (parallel tempering).\n";
+            std::cout << "  --mode name           Optional. Legalization engine: greedy, abacus or tetris (default: greedy).\n";
+            std::cout << "  --brute-density       Optional. Use the reference O(n^2) density computation.\n";
+            std::cout << "  --hpwl-weight double  Optional. Anneal displacement plus this weight times HPWL (default: 0).\n";
+            std::cout << "  --max-displacement double\n";
+            std::cout << "                        Optional. Keep every cell within this distance of its global placement where possible (greedy mode).\n";
+            std::cout << "  --no-refine           Optional. Skip the reassignment and row shifting passes after greedy placement.\n";
+            std::cout << "  --cooling name        Optional. Annealing schedule: lam (adaptive) or geometric (default: lam).\n";
+            std::cout << "  --stall-moves int     Optional. Stop an annealing run after this many moves without improvement, 0 to disable (default: 100000).\n";
+            std::cout << "  --min-gain double     Optional. Stop annealing after a pass gaining less than this fraction of the cost, 0 to disable (default: 1e-4).\n";
+            std::cout << "  --eco-baseline file   Optional. Keep cells that did not move since this legalized .pl and re-legalize only the rest.\n";
+            std::cout << "  --load-snapshot file  Optional. Read the design from a binary snapshot instead of parsing INPUT_DIR.\n";
+            std::cout << "  --save-snapshot file  Optional. Write a binary snapshot of the design after legalization.\n";
+            std::cout << "  --parse-only          Optional. Stop after parsing; with --save-snapshot, snapshot the parsed design.\n";
+            std::cout << "  --link-inputs         Optional. Hard-link unchanged input files into OUTPUT_DIR instead of copying.\n";
             return 0;
         }
     }
@@ -43,6 +61,21 @@ int main(int argc, char* argv[]) {
 
     double epsilon = 10.0; // Default epsilon
     double timer = 5.0;   // Default timer in minutes
+    bool bruteDensity = false;
+    std::string mode = "greedy";
+    int threads = 1;
+    int replicas = 0;
+    double hpwlWeight = 0.0;
+    double maxDisplacement = 0.0;
+    bool refine = true;
+    std::string cooling = "lam";
+    long long stallMoves = 100000;
+    double minGain = 1e-4;
+    std::string ecoBaselineFile;
+    std::string loadSnapshotFile;
+    std::string saveSnapshotFile;
+    bool parseOnly = false;
+    bool linkInputs = false;
 
     // Parse optional arguments
     for (int i = 3; i < argc; ++i) {
@@ -50,9 +83,47 @@ int main(int argc, char* argv[]) {
             epsilon = std::strtod(argv[++i], nullptr);
         } else if (std::string(argv[i]) == "-t" && i + 1 < argc) {
             timer = std::strtod(argv[++i], nullptr);
+        } else if (std::string(argv[i]) == "-j" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--replicas" && i + 1 < argc) {
+            replicas = std::atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--mode" && i + 1 < argc) {
+            mode = argv[++i];
+            if (mode != "greedy" && mode != "abacus" && mode != "tetris") {
+                std::cout << "Unknown mode: " << mode << std::endl;
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--brute-density") {
+            bruteDensity = true;
+        } else if (std::string(argv[i]) == "--hpwl-weight" && i + 1 < argc) {
+            hpwlWeight = std::strtod(argv[++i], nullptr);
+        } else if (std::string(argv[i]) == "--max-displacement" && i + 1 < argc) {
+            maxDisplacement = std::strtod(argv[++i], nullptr);
+        } else if (std::string(argv[i]) == "--no-refine") {
+            refine = false;
+        } else if (std::string(argv[i]) == "--cooling" && i + 1 < argc) {
+            cooling = argv[++i];
+            if (cooling != "lam" && cooling != "geometric") {
+                std::cout << "Unknown cooling schedule: " << cooling << std::endl;
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--stall-moves" && i + 1 < argc) {
+            stallMoves = std::atoll(argv[++i]);
+        } else if (std::string(argv[i]) == "--min-gain" && i + 1 < argc) {
+            minGain = std::strtod(argv[++i], nullptr);
+        } else if (std::string(argv[i]) == "--eco-baseline" && i + 1 < argc) {
+            ecoBaselineFile = argv[++i];
+        } else if (std::string(argv[i]) == "--load-snapshot" && i + 1 < argc) {
+            loadSnapshotFile = argv[++i];
+        } else if (std::string(argv[i]) == "--save-snapshot" && i + 1 < argc) {
+            saveSnapshotFile = argv[++i];
+        } else if (std::string(argv[i]) == "--parse-only") {
+            parseOnly = true;
+        } else if (std::string(argv[i]) == "--link-inputs") {
+            linkInputs = true;
         } else {
             std::cout << "Unknown argument: " << argv[i] << std::endl;
-            std::cout << "Usage: legalizer INPUT_DIR OUTPUT_DIR [-e double] [-t double]" << std::endl;
+            std::cout << "Usage: legalizer INPUT_DIR OUTPUT_DIR [-e double] [-t double] [-j int] [--replicas int] [--mode greedy|abacus|tetris] [--brute-density] [--hpwl-weight double] [--max-displacement double] [--no-refine] [--cooling lam|geometric] [--stall-moves int] [--min-gain double] [--eco-baseline file] [--load-snapshot file] [--save-snapshot file] [--parse-only] [--link-inputs]" << std::endl;
             return 1;
         }
     }
@@ -82,23 +153,94 @@ int main(int argc, char* argv[]) {
     }
 
     Parser parser(inputPath, inputFilePrefix);
-    parser.parse();
+    if (!loadSnapshotFile.empty()) {
+        // INPUT_DIR is still needed for the files copied to the output
+        if (!Snapshot::load(loadSnapshotFile, parser.cells, parser.nets, parser.rows, parser.siteWidth, parser.siteHeight)) {
+            return 1;
+        }
+        // Legalization always starts over from the global placement
+        parser.cells.resetPositions();
+    } else {
+        parser.setThreadCount(threads);
+        parser.parse();
+    }
+
+    // Snapshot of the parsed design, before any cell has moved
+    if (parseOnly) {
+        if (!saveSnapshotFile.empty() &&
+            !Snapshot::save(saveSnapshotFile, parser.cells, parser.nets, parser.rows, parser.siteWidth, parser.siteHeight)) {
+            return 1;
+        }
+        return 0;
+    }
+
+    // Earlier legal placement for ECO mode
+    std::vector<double> baselineX, baselineY;
+    std::vector<char> baselineListed;
+    if (!ecoBaselineFile.empty() && !parser.parsePlacement(ecoBaselineFile, baselineX, baselineY, baselineListed)) {
+        return 1;
+    }
+
+    // Wirelength of the global placement, reported next to the legalized one
+    NetBoxCache wirelength(parser.nets, parser.cells);
+    double wirelengthBefore = wirelength.total();
 
     Legalizer legalizer(parser.cells, parser.rows, parser.siteWidth);
+    legalizer.setThreadCount(threads);
+    if (hpwlWeight > 0) {
+        legalizer.setWirelengthWeight(parser.nets, hpwlWeight);
+    }
+    if (maxDisplacement > 0) {
+        legalizer.setMaxDisplacement(maxDisplacement);
+    }
+    legalizer.setAnnealingSchedule(cooling == "lam", stallMoves, minGain);
     std::cout << "Legalizing..." << std::endl;
-    legalizer.computeDensity(epsilon);
-    legalizer.sortAndCluster();
-    std::cout << "Placing cells..." << std::endl;
-    legalizer.placeCells();
-    std::cout << "Simulated annealing..." << std::endl;
-    legalizer.simulatedAnnealing(timer); // Use the specified timer value
+    if (!ecoBaselineFile.empty()) {
+        std::cout << "Placing cells (ECO)..." << std::endl;
+        int moved = legalizer.placeCellsIncremental(baselineX, baselineY, baselineListed);
+        std::cout << "Re-legalized cells: " << moved << std::endl;
+    } else if (mode == "abacus") {
+        std::cout << "Placing cells (Abacus)..." << std::endl;
+        legalizer.placeCellsAbacus();
+    } else if (mode == "tetris") {
+        std::cout << "Placing cells (Tetris)..." << std::endl;
+        legalizer.placeCellsTetris();
+    } else {
+        legalizer.computeDensity(epsilon, bruteDensity);
+        legalizer.sortAndCluster();
+        std::cout << "Placing cells..." << std::endl;
+        legalizer.placeCells();
+        if (refine) {
+            std::cout << "Refining..." << std::endl;
+            for (int round = 0; round < 2; ++round) {
+                legalizer.refineAssignment();
+                legalizer.refineRows();
+            }
+        }
+        if (replicas > 1) {
+            std::cout << "Parallel tempering..." << std::endl;
+            legalizer.parallelTempering(timer, replicas);
+        } else {
+            std::cout << "Simulated annealing..." << std::endl;
+            legalizer.simulatedAnnealing(timer); // Use the specified timer value
+        }
+    }
     legalizer.calculateDisplacement();
     legalizer.checkOverlap();
 
     std::cout << "Total Displacement: " << legalizer.getTotalDisplacement() << std::endl;
     std::cout << "Max Displacement: " << legalizer.getMaxDisplacement() << std::endl;
+    if (parser.nets.size() > 0) {
+        wirelength.build();
+        std::cout << "HPWL Before: " << wirelengthBefore << std::endl;
+        std::cout << "HPWL After: " << wirelength.total() << std::endl;
+    }
+
+    if (!saveSnapshotFile.empty()) {
+        Snapshot::save(saveSnapshotFile, parser.cells, parser.nets, parser.rows, parser.siteWidth, parser.siteHeight);
+    }
 
-    Utilities::writeOutput(inputPath, inputFilePrefix, outputPath, outputFilePrefix, parser.cells, parser.rows);
+    Utilities::writeOutput(inputPath, inputFilePrefix, outputPath, outputFilePrefix, parser.cells, parser.rows, linkInputs);
 
     return 0;
 }